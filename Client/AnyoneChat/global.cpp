@@ -18,4 +18,5 @@ std::function<QString(QString)> xorString = [](QString input){
 };
 
 QString gate_url_prefix = "";
+bool gate_http2 = false;
 
@@ -40,23 +40,38 @@ enum ReqId{
     ID_NOTIFY_OFF_LINE_REQ = 1021, //通知用户下线
     ID_HEART_BEAT_REQ = 1023,      //心跳请求
     ID_HEARTBEAT_RSP = 1024,       //心跳回复
+    ID_FRIEND_LIST_REQ = 1025,     //分页拉取好友列表请求
+    ID_FRIEND_LIST_RSP = 1026,     //分页拉取好友列表回复
+    ID_FRIEND_SYNC_REQ = 1027,     //好友增量同步请求
+    ID_FRIEND_SYNC_RSP = 1028,     //好友增量同步回复
+    ID_NOTIFY_MIGRATE_REQ = 1029,  //通知用户迁移到其他服务器
+};
+
+//好友增量同步的变更类型, 与服务器FriendChangeOp一致
+enum FriendChangeOp
+{
+    FRIEND_CHANGE_ADD        = 1,  // 新增好友
+    FRIEND_CHANGE_DEL        = 2,  // 删除好友
+    FRIEND_CHANGE_APPLY      = 3,  // 收到好友申请
+    FRIEND_CHANGE_APPLY_AUTH = 4,  // 好友申请状态变更
 };
 
 enum ErrorCodes
 {
-    Success        = 0,
-    Error_NetWork  = 1000,
-    Error_Json     = 1001,  // Json解析错误
-    RPCFailed      = 1002,  // RPC请求错误
-    VarifyExpired  = 1003,  // 验证码过期
-    VarifyCodeErr  = 1004,  // 验证码错误
-    UserExist      = 1005,  // 用户已经存在
-    PasswdErr      = 1006,  // 密码错误
-    EmailNotMatch  = 1007,  // 邮箱不匹配
-    PasswdUpFailed = 1008,  // 更新密码失败
-    PasswdInvalid  = 1009,  // 密码更新失败
-    TokenInvalid   = 1010,  // Token失效
-    UidInvalid     = 1011,  // uid无效
+    Success         = 0,
+    Error_NetWork   = 1000,
+    Error_Json      = 1001,  // Json解析错误
+    RPCFailed       = 1002,  // RPC请求错误
+    VarifyExpired   = 1003,  // 验证码过期
+    VarifyCodeErr   = 1004,  // 验证码错误
+    UserExist       = 1005,  // 用户已经存在
+    PasswdErr       = 1006,  // 密码错误
+    EmailNotMatch   = 1007,  // 邮箱不匹配
+    PasswdUpFailed  = 1008,  // 更新密码失败
+    PasswdInvalid   = 1009,  // 密码更新失败
+    TokenInvalid    = 1010,  // Token失效
+    UidInvalid      = 1011,  // uid无效
+    TooManyRequests = 1012,  // 请求过于频繁
 };
 
 enum Modules{
@@ -72,6 +87,8 @@ enum ClickLbState{
 
 
 extern QString gate_url_prefix;
+// GateServer 开启 h2c 时, 所有 http 请求复用一条 HTTP/2 连接
+extern bool gate_http2;
 
 
 struct ServerInfo{
@@ -13,6 +13,8 @@ void HttpMgr::PostHttpReq(QUrl url, QJsonObject json, ReqId req_id, Modules mod)
     QNetworkRequest request(url);
     request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
     request.setHeader(QNetworkRequest::ContentLengthHeader, QByteArray::number(data.length()));
+    //直接以 HTTP/2 发起请求, 多个请求在同一连接上多路复用
+    request.setAttribute(QNetworkRequest::Http2DirectAttribute, gate_http2);
     //发送请求，并处理响应, 获取自己的智能指针，构造伪闭包并增加智能指针引用计数
     auto self = shared_from_this();
     QNetworkReply * reply = _manager.post(request, data);
@@ -32,6 +32,7 @@ int main(int argc, char *argv[])
     QString gate_host = settings.value("GateServer/host").toString();
     QString gate_port = settings.value("GateServer/port").toString();
     gate_url_prefix = "http://"+gate_host+":"+gate_port;
+    gate_http2 = settings.value("GateServer/http2", false).toBool();
 
     // 创建一个动画效果
     // QPropertyAnimation *animation = new QPropertyAnimation(button, "geometry");
@@ -1,11 +1,26 @@
 #include "tcpmgr.h"
 #include <QAbstractSocket>
+#include <QTimer>
 #include "usermgr.h"
 
-TcpMgr::TcpMgr():_host(""),_port(0),_b_recv_pending(false),_message_id(0),_message_len(0)
+TcpMgr::TcpMgr():_host(""),_port(0),_b_recv_pending(false),_message_id(0),_message_len(0),_migrating(false)
 {
     QObject::connect(&_socket, &QTcpSocket::connected, [&]() {
            qDebug() << "Connected to server!";
+           //迁移时由TcpMgr直接登录, 不经过登录界面
+           if(_migrating){
+               QJsonObject jsonObj;
+               jsonObj["uid"] = _migrate_info.Uid;
+               jsonObj["token"] = _migrate_info.Token;
+               //带上本地同步版本号, 服务器跳过全量列表, 改为增量同步
+               auto sync_version = UserMgr::GetInstance()->GetSyncVersion();
+               if(sync_version > 0){
+                   jsonObj["sync_version"] = sync_version;
+               }
+               QJsonDocument doc(jsonObj);
+               slot_send_data(ReqId::ID_CHAT_LOGIN, doc.toJson(QJsonDocument::Compact));
+               return;
+           }
            // 连接建立后发送消息
             emit sig_con_success(true);
        });
@@ -65,6 +80,12 @@ TcpMgr::TcpMgr():_host(""),_port(0),_b_recv_pending(false),_message_id(0),_messa
         QObject::connect(&_socket, static_cast<void (QTcpSocket::*)(QTcpSocket::SocketError)>(&QTcpSocket::error),
                             [&](QTcpSocket::SocketError socketError) {
                qDebug() << "Error:" << _socket.errorString() ;
+               //迁移时连接新服务器失败, 按异常断线处理
+               if(_migrating && _socket.state() != QAbstractSocket::ConnectedState){
+                   _migrating = false;
+                   emit sig_connection_closed();
+                   return;
+               }
                switch (socketError) {
                    case QTcpSocket::ConnectionRefusedError:
                        qDebug() << "Connection Refused!";
@@ -93,6 +114,10 @@ TcpMgr::TcpMgr():_host(""),_port(0),_b_recv_pending(false),_message_id(0),_messa
         // 处理连接断开
         QObject::connect(&_socket, &QTcpSocket::disconnected, [&]() {
             qDebug() << "Disconnected from server.";
+            //迁移时主动断开旧连接, 不通知界面
+            if(_migrating){
+                return;
+            }
             //并且发送通知到界面
             emit sig_connection_closed();
         });
@@ -127,6 +152,28 @@ void TcpMgr::initHandlers()
         QJsonObject jsonObj = jsonDoc.object();
         qDebug()<< "data jsonobj is " << jsonObj ;
 
+        //迁移后的重新登录, 本地数据沿用, 不再切换界面
+        if(_migrating){
+            _migrating = false;
+            if(!jsonObj.contains("error") || jsonObj["error"].toInt() != ErrorCodes::Success){
+                qDebug() << "Migrate Login Failed";
+                emit sig_connection_closed();
+                return;
+            }
+            UserMgr::GetInstance()->SetToken(jsonObj["token"].toString());
+            //拉取迁移期间的好友变更, 没有本地版本号时沿用本地数据
+            if(jsonObj["friend_sync"].toBool()){
+                QJsonObject reqObj;
+                reqObj["version"] = UserMgr::GetInstance()->GetSyncVersion();
+                QJsonDocument doc(reqObj);
+                slot_send_data(ReqId::ID_FRIEND_SYNC_REQ, doc.toJson(QJsonDocument::Compact));
+                return;
+            }
+            UserMgr::GetInstance()->SetSyncVersion(
+                static_cast<qint64>(jsonObj["sync_version"].toDouble()));
+            return;
+        }
+
         if(!jsonObj.contains("error")){
             int err = ErrorCodes::Error_Json;
             qDebug() << "Login Failed, err is Json Parse Err" << err ;
@@ -151,18 +198,132 @@ void TcpMgr::initHandlers()
  
         UserMgr::GetInstance()->SetUserInfo(user_info);
         UserMgr::GetInstance()->SetToken(jsonObj["token"].toString());
+        //记录好友变更版本号, 重连后据此增量同步
+        UserMgr::GetInstance()->SetSyncVersion(
+            static_cast<qint64>(jsonObj["sync_version"].toDouble()));
         if(jsonObj.contains("apply_list")){
             UserMgr::GetInstance()->AppendApplyList(jsonObj["apply_list"].toArray());
         }
 
-        //添加好友列表
+        //添加好友列表, 登录只带第一页
         if (jsonObj.contains("friend_list")) {
             UserMgr::GetInstance()->AppendFriendList(jsonObj["friend_list"].toArray());
         }
+        UserMgr::GetInstance()->SetFriendEtag(jsonObj["friend_etag"].toString());
+
+        //还有剩余页则继续拉取, 拉取完成后再切换到聊天界面
+        auto next = jsonObj["friend_next"].toInt();
+        if (next != 0) {
+            QJsonObject reqObj;
+            reqObj["cursor"] = next;
+            reqObj["etag"] = UserMgr::GetInstance()->GetFriendEtag();
+            QJsonDocument doc(reqObj);
+            slot_send_data(ReqId::ID_FRIEND_LIST_REQ, doc.toJson(QJsonDocument::Compact));
+            return;
+        }
 
         emit sig_swich_chatdlg();
     });
 
+    _handlers.insert(ID_FRIEND_LIST_RSP, [this](ReqId id, int len, QByteArray data) {
+        Q_UNUSED(len);
+        qDebug() << "handle id is " << id << " data is " << data;
+        QJsonDocument jsonDoc = QJsonDocument::fromJson(data);
+        if (jsonDoc.isNull()) {
+            qDebug() << "Failed to create QJsonDocument.";
+            emit sig_swich_chatdlg();
+            return;
+        }
+
+        QJsonObject jsonObj = jsonDoc.object();
+        int err = jsonObj["error"].toInt();
+        if (!jsonObj.contains("error") || err != ErrorCodes::Success) {
+            //拉取失败时使用已加载的部分列表
+            qDebug() << "Get Friend List Failed, err is " << err;
+            emit sig_swich_chatdlg();
+            return;
+        }
+
+        //列表未变化, 沿用本地数据
+        if (jsonObj["unchanged"].toBool()) {
+            emit sig_swich_chatdlg();
+            return;
+        }
+
+        if (jsonObj.contains("friend_list")) {
+            UserMgr::GetInstance()->AppendFriendList(jsonObj["friend_list"].toArray());
+        }
+        UserMgr::GetInstance()->SetFriendEtag(jsonObj["etag"].toString());
+
+        auto next = jsonObj["friend_next"].toInt();
+        if (next != 0) {
+            QJsonObject reqObj;
+            reqObj["cursor"] = next;
+            reqObj["etag"] = UserMgr::GetInstance()->GetFriendEtag();
+            QJsonDocument doc(reqObj);
+            slot_send_data(ReqId::ID_FRIEND_LIST_REQ, doc.toJson(QJsonDocument::Compact));
+            return;
+        }
+
+        emit sig_swich_chatdlg();
+    });
+
+    _handlers.insert(ID_FRIEND_SYNC_RSP, [this](ReqId id, int len, QByteArray data) {
+        Q_UNUSED(len);
+        qDebug() << "handle id is " << id << " data is " << data;
+        QJsonDocument jsonDoc = QJsonDocument::fromJson(data);
+        if (jsonDoc.isNull()) {
+            qDebug() << "Failed to create QJsonDocument.";
+            return;
+        }
+
+        QJsonObject jsonObj = jsonDoc.object();
+        int err = jsonObj["error"].toInt();
+        if (!jsonObj.contains("error") || err != ErrorCodes::Success) {
+            //同步失败时保留版本号, 下次重连再拉取
+            qDebug() << "Sync Friend Failed, err is " << err;
+            return;
+        }
+
+        //变更可能与已收到的通知重复, 界面槽函数按uid去重
+        for (const QJsonValue& value : jsonObj["changes"].toArray()) {
+            auto op = value["op"].toInt();
+            auto uid = value["uid"].toInt();
+            auto name = value["name"].toString();
+            auto nick = value["nick"].toString();
+            auto icon = value["icon"].toString();
+            auto desc = value["desc"].toString();
+            auto sex = value["sex"].toInt();
+            switch (op) {
+            case FRIEND_CHANGE_ADD:
+                emit sig_add_auth_friend(std::make_shared<AuthInfo>(uid, name, nick, icon, sex));
+                break;
+            case FRIEND_CHANGE_DEL:
+                UserMgr::GetInstance()->RemoveFriend(uid);
+                break;
+            case FRIEND_CHANGE_APPLY:
+                if (value["status"].toInt() == 0) {
+                    emit sig_friend_apply(std::make_shared<AddFriendApply>(uid, name, desc, icon, nick, sex));
+                }
+                break;
+            case FRIEND_CHANGE_APPLY_AUTH:
+                UserMgr::GetInstance()->UpdateApplyStatus(uid, value["status"].toInt());
+                break;
+            default:
+                qDebug() << "unknown friend change op " << op;
+                break;
+            }
+        }
+
+        auto version = static_cast<qint64>(jsonObj["version"].toDouble());
+        UserMgr::GetInstance()->SetSyncVersion(version);
+        if (jsonObj["more"].toBool()) {
+            QJsonObject reqObj;
+            reqObj["version"] = version;
+            QJsonDocument doc(reqObj);
+            slot_send_data(ReqId::ID_FRIEND_SYNC_REQ, doc.toJson(QJsonDocument::Compact));
+        }
+    });
 
 	_handlers.insert(ID_SEARCH_USER_RSP, [this](ReqId id, int len, QByteArray data) {
 		Q_UNUSED(len);
@@ -443,6 +604,37 @@ void TcpMgr::initHandlers()
 
     });
 
+    _handlers.insert(ID_NOTIFY_MIGRATE_REQ,[this](ReqId id, int len, QByteArray data){
+        Q_UNUSED(len);
+        qDebug() << "handle id is " << id << " data is " << data;
+        QJsonDocument jsonDoc = QJsonDocument::fromJson(data);
+        if (jsonDoc.isNull()) {
+            qDebug() << "Failed to create QJsonDocument.";
+            return;
+        }
+
+        QJsonObject jsonObj = jsonDoc.object();
+        int err = jsonObj["error"].toInt();
+        if (!jsonObj.contains("error") || err != ErrorCodes::Success) {
+            qDebug() << "Migrate Notify Failed, err is " << err;
+            return;
+        }
+
+        //没有分配到新服务器时, 等待旧服务器关闭连接后重新登录
+        if (jsonObj["host"].toString().isEmpty()) {
+            qDebug() << "Migrate Notify without server";
+            return;
+        }
+
+        _migrate_info.Uid = jsonObj["uid"].toInt();
+        _migrate_info.Host = jsonObj["host"].toString();
+        _migrate_info.Port = jsonObj["port"].toString();
+        _migrate_info.Token = jsonObj["token"].toString();
+        //服务器已错开各用户的通知时间, 收到后即可切换
+        //放到下一轮事件循环中执行, 避免在readyRead中关闭socket
+        QTimer::singleShot(0, this, [this](){ migrate(); });
+    });
+
     _handlers.insert(ID_HEARTBEAT_RSP,[this](ReqId id, int len, QByteArray data){
         Q_UNUSED(len);
         qDebug() << "handle id is " << id << " data is " << data;
@@ -486,6 +678,16 @@ void TcpMgr::handleMsg(ReqId id, int len, QByteArray data)
    find_iter.value()(id,len,data);
 }
 
+void TcpMgr::migrate()
+{
+    qDebug() << "Migrate to server " << _migrate_info.Host << ":" << _migrate_info.Port;
+    _migrating = true;
+    _socket.abort();
+    _buffer.clear();
+    _b_recv_pending = false;
+    slot_tcp_connect(_migrate_info);
+}
+
 void TcpMgr::slot_tcp_connect(ServerInfo si)
 {
     qDebug()<< "receive tcp connect signal";
@@ -20,6 +20,8 @@ private:
     TcpMgr();
     void initHandlers();
     void handleMsg(ReqId id, int len, QByteArray data);
+    //服务器排空时切换到新服务器, 用下发的token重新登录
+    void migrate();
     QTcpSocket _socket;
     QString _host;
     uint16_t _port;
@@ -27,6 +29,8 @@ private:
     bool _b_recv_pending;
     quint16 _message_id;
     quint16 _message_len;
+    bool _migrating;
+    ServerInfo _migrate_info;
     QMap<ReqId, std::function<void(ReqId id, int len, QByteArray data)>> _handlers;
 public slots:
     void slot_tcp_connect(ServerInfo);
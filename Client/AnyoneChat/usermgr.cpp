@@ -16,6 +16,26 @@ void UserMgr::SetToken(QString token)
     _token = token;
 }
 
+void UserMgr::SetFriendEtag(QString etag)
+{
+    _friend_etag = etag;
+}
+
+QString UserMgr::GetFriendEtag()
+{
+    return _friend_etag;
+}
+
+void UserMgr::SetSyncVersion(qint64 version)
+{
+    _sync_version = version;
+}
+
+qint64 UserMgr::GetSyncVersion()
+{
+    return _sync_version;
+}
+
 int UserMgr::GetUid()
 {
     return _user_info->_uid;
@@ -102,6 +122,16 @@ bool UserMgr::AlreadyApply(int uid)
     return false;
 }
 
+void UserMgr::UpdateApplyStatus(int uid, int status)
+{
+    for(auto& apply: _apply_list){
+        if(apply->_uid == uid){
+            apply->_status = status;
+            return;
+        }
+    }
+}
+
 std::vector<std::shared_ptr<FriendInfo>> UserMgr::GetChatListPerPage() {
     
     std::vector<std::shared_ptr<FriendInfo>> friend_list;
@@ -239,6 +269,17 @@ std::shared_ptr<FriendInfo> UserMgr::GetFriendById(int uid)
     return *find_it;
 }
 
+void UserMgr::RemoveFriend(int uid)
+{
+    _friend_map.remove(uid);
+    for(auto iter = _friend_list.begin(); iter != _friend_list.end(); ++iter){
+        if((*iter)->_uid == uid){
+            _friend_list.erase(iter);
+            return;
+        }
+    }
+}
+
 void UserMgr::AppendFriendChatMsg(int friend_id,std::vector<std::shared_ptr<TextChatData> > msgs)
 {
     auto find_iter = _friend_map.find(friend_id);
@@ -257,6 +298,8 @@ void UserMgr::CleanAllInfo()
     _friend_list.clear();
     _friend_map.clear();
     _token.clear();
+    _friend_etag.clear();
+    _sync_version = 0;
     _chat_loaded = 0;
     _contact_loaded = 0;
 }
@@ -14,6 +14,10 @@ public:
     ~ UserMgr();
     void SetUserInfo(std::shared_ptr<UserInfo> user_info);
     void SetToken(QString token);
+    void SetFriendEtag(QString etag);
+    QString GetFriendEtag();
+    void SetSyncVersion(qint64 version);
+    qint64 GetSyncVersion();
     int GetUid();
     QString GetName();
     QString GetNick();
@@ -25,6 +29,7 @@ public:
     std::vector<std::shared_ptr<ApplyInfo>> GetApplyList();
     void AddApplyList(std::shared_ptr<ApplyInfo> app);
     bool AlreadyApply(int uid);
+    void UpdateApplyStatus(int uid, int status);
     std::vector<std::shared_ptr<FriendInfo>> GetChatListPerPage();
     bool IsLoadChatFin();
     void UpdateChatLoadedCount();
@@ -35,6 +40,7 @@ public:
     void AddFriend(std::shared_ptr<AuthRsp> auth_rsp);
     void AddFriend(std::shared_ptr<AuthInfo> auth_info);
     std::shared_ptr<FriendInfo> GetFriendById(int uid);
+    void RemoveFriend(int uid);
     void AppendFriendChatMsg(int friend_id,std::vector<std::shared_ptr<TextChatData>>);
     void CleanAllInfo();
 private:
@@ -44,6 +50,8 @@ private:
     std::vector<std::shared_ptr<FriendInfo>> _friend_list;
     QMap<int, std::shared_ptr<FriendInfo>> _friend_map;
     QString _token;
+    QString _friend_etag;
+    qint64 _sync_version;
     int _chat_loaded;
     int _contact_loaded;
 
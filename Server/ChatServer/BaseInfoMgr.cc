@@ -0,0 +1,109 @@
+#include "BaseInfoMgr.h"
+#include "JsonWriter.h"
+#include "Logger.h"
+#include "MysqlMgr.h"
+#include "RedisMgr.h"
+#include "const.h"
+
+#include <jsoncpp/json/json.h>
+#include <jsoncpp/json/reader.h>
+#include <jsoncpp/json/value.h>
+
+bool BaseInfoMgr::GetBaseInfo(int uid, std::shared_ptr<UserInfo>& userinfo)
+{
+    std::unordered_map<int, std::shared_ptr<UserInfo>> infos;
+    if (!GetBaseInfos({uid}, infos))
+    {
+        return false;
+    }
+
+    auto iter = infos.find(uid);
+    if (iter == infos.end())
+    {
+        return false;
+    }
+    userinfo = iter->second;
+    return true;
+}
+
+bool BaseInfoMgr::GetBaseInfos(const std::vector<int>&   uids,
+    std::unordered_map<int, std::shared_ptr<UserInfo>>& infos)
+{
+    if (uids.empty())
+    {
+        return true;
+    }
+
+    // 优先一次MGET从redis中查询用户信息
+    std::vector<std::string> keys;
+    keys.reserve(uids.size());
+    for (auto uid : uids)
+    {
+        keys.push_back(USER_BASE_INFO + std::to_string(uid));
+    }
+
+    std::vector<std::string> values;
+    std::vector<bool>        found;
+    bool b_redis = RedisMgr::GetInstance()->MGet(keys, values, found);
+
+    std::vector<int> miss_uids;
+    for (size_t i = 0; i < uids.size(); ++i)
+    {
+        if (!b_redis || !found[i])
+        {
+            miss_uids.push_back(uids[i]);
+            continue;
+        }
+
+        Json::Reader reader;
+        Json::Value  root;
+        if (!reader.parse(values[i], root))
+        {
+            miss_uids.push_back(uids[i]);
+            continue;
+        }
+        auto userinfo    = std::make_shared<UserInfo>();
+        userinfo->uid_   = root["uid"].asInt();
+        userinfo->name_  = root["name"].asString();
+        userinfo->pwd_   = root["pwd"].asString();
+        userinfo->email_ = root["email"].asString();
+        userinfo->nick_  = root["nick"].asString();
+        userinfo->desc_  = root["desc"].asString();
+        userinfo->sex_   = root["sex"].asInt();
+        userinfo->icon_  = root["icon"].asString();
+        infos[uids[i]]   = userinfo;
+    }
+
+    if (miss_uids.empty())
+    {
+        return true;
+    }
+
+    // redis中没有的一次性从mysql查询
+    LOG_INFO("Turn to SQL to get user info, count: {}", miss_uids.size());
+    std::vector<std::shared_ptr<UserInfo>> users;
+    if (!MysqlMgr::GetInstance()->GetUsers(miss_uids, users))
+    {
+        LOG_ERROR("Mysql get user infos failed, count: {}", miss_uids.size());
+        return false;
+    }
+
+    // 将数据库内容写入redis缓存
+    for (auto& userinfo : users)
+    {
+        Json::Value redis_root;
+        redis_root["uid"]   = userinfo->uid_;
+        redis_root["pwd"]   = userinfo->pwd_;
+        redis_root["name"]  = userinfo->name_;
+        redis_root["email"] = userinfo->email_;
+        redis_root["nick"]  = userinfo->nick_;
+        redis_root["desc"]  = userinfo->desc_;
+        redis_root["sex"]   = userinfo->sex_;
+        redis_root["icon"]  = userinfo->icon_;
+        RedisMgr::GetInstance()->Set(USER_BASE_INFO +
+                                         std::to_string(userinfo->uid_),
+            JsonWriter::Write(redis_root));
+        infos[userinfo->uid_] = userinfo;
+    }
+    return true;
+}
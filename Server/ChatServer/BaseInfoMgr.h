@@ -0,0 +1,24 @@
+#pragma once
+#include "Singleton.h"
+#include "data.h"
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+// 用户基础信息的旁路缓存: 先批量查redis, 未命中的一次性从mysql补齐并回写
+class BaseInfoMgr : public Singleton<BaseInfoMgr>
+{
+    friend class Singleton<BaseInfoMgr>;
+
+  public:
+    ~BaseInfoMgr() {}
+
+    bool GetBaseInfo(int uid, std::shared_ptr<UserInfo>& userinfo);
+    // 不存在的uid不出现在infos中, redis和mysql都失败时返回false
+    bool GetBaseInfos(const std::vector<int>&              uids,
+        std::unordered_map<int, std::shared_ptr<UserInfo>>& infos);
+
+  private:
+    BaseInfoMgr() {}
+};
@@ -1,4 +1,5 @@
 #include "ChatGrpcClient.h"
+#include "BaseInfoMgr.h"
 #include "ConfigMgr.h"
 #include "Logger.h"
 #include "MysqlMgr.h"
@@ -73,64 +74,8 @@ AddFriendRsp ChatGrpcClient::NotifyAddFriend(
 bool ChatGrpcClient::GetBaseInfo(
     const std::string& base_key, int uid, std::shared_ptr<UserInfo>& userinfo)
 {
-    // 优先查redis中查询用户信息
-    LOG_INFO("Redis get user info key: {}", base_key);
-    std::string info_str = "";
-    bool        b_base   = RedisMgr::GetInstance()->Get(base_key, info_str);
-    if (b_base)
-    {
-        Json::Reader reader;
-        Json::Value  root;
-        reader.parse(info_str, root);
-        userinfo->uid_   = root["uid"].asInt();
-        userinfo->name_  = root["name"].asString();
-        userinfo->pwd_   = root["pwd"].asString();
-        userinfo->email_ = root["email"].asString();
-        userinfo->nick_  = root["nick"].asString();
-        userinfo->desc_  = root["desc"].asString();
-        userinfo->sex_   = root["sex"].asInt();
-        userinfo->icon_  = root["icon"].asString();
-        LOG_INFO("Redis get user info succeed, key: {}, uid: {}, name: {}, "
-                 "pwd: {}, email: {}",
-                 base_key, userinfo->uid_, userinfo->name_, userinfo->pwd_,
-                 userinfo->email_);
-    }
-    else
-    {
-        LOG_INFO("Redis get user info failed, key: {}", base_key);
-        LOG_INFO("Turn to SQL to get user info, uid: {}", uid);
-        // redis中没有则查询mysql
-        // 查询数据库
-        std::shared_ptr<UserInfo> user_info = nullptr;
-        user_info = MysqlMgr::GetInstance()->GetUser(uid);
-        if (user_info == nullptr)
-        {
-            LOG_ERROR("Get user info from mysql failed, uid: {}", uid);
-            return false;
-        }
-
-        LOG_INFO("Get user info from mysql succeed, uid: {}, name: {}, pwd: "
-                 "{}, email: {}, nick: {}, desc: {}, sex: {}, icon: {}",
-                 uid, user_info->name_, user_info->pwd_, user_info->email_,
-                 user_info->nick_, user_info->desc_, user_info->sex_,
-                 user_info->icon_);
-
-        userinfo = user_info;
-
-        LOG_INFO("Redis set user info key: {}", base_key);
-        // 将数据库内容写入redis缓存
-        Json::Value redis_root;
-        redis_root["uid"]   = uid;
-        redis_root["pwd"]   = userinfo->pwd_;
-        redis_root["name"]  = userinfo->name_;
-        redis_root["email"] = userinfo->email_;
-        redis_root["nick"]  = userinfo->nick_;
-        redis_root["desc"]  = userinfo->desc_;
-        redis_root["sex"]   = userinfo->sex_;
-        redis_root["icon"]  = userinfo->icon_;
-        RedisMgr::GetInstance()->Set(base_key, redis_root.toStyledString());
-    }
-    return true;
+    // 缓存读取与回写统一由BaseInfoMgr处理
+    return BaseInfoMgr::GetInstance()->GetBaseInfo(uid, userinfo);
 }
 
 AuthFriendRsp ChatGrpcClient::NotifyAuthFriend(
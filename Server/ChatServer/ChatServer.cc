@@ -2,32 +2,98 @@
 #include "AsioIOServicePool.h"
 #include "Session.h"
 #include "ConfigMgr.h"
+#include "JsonWriter.h"
 #include "Logger.h"
 #include "RedisMgr.h"
 #include "UserMgr.h"
+#include "message.grpc.pb.h"
 
+#include <algorithm>
+#include <grpcpp/grpcpp.h>
+#include <jsoncpp/json/value.h>
 #include <memory>
 #include <vector>
 
+namespace
+{
+// 向 StatusServer 为用户申请新的服务器和 token, 随迁移通知一起下发
+// 申请失败时通知中不带地址, 客户端等连接断开后重新走登录流程
+// self_host 为 0.0.0.0 时只按端口判断分配结果是否为本机
+void NotifyMigrate(message::StatusService::Stub& stub,
+    std::shared_ptr<Session> session, const std::string& self_host,
+    const std::string& self_port)
+{
+    int uid = session->GetUserId();
+    if (uid == 0)
+    {
+        // 尚未登录的连接直接等超时关闭
+        return;
+    }
+
+    grpc::ClientContext       context;
+    message::GetChatServerReq request;
+    message::GetChatServerRsp reply;
+    context.set_deadline(
+        std::chrono::system_clock::now() + std::chrono::seconds(3));
+    request.set_uid(uid);
+    auto status = stub.GetChatServer(&context, request, &reply);
+
+    // StatusServer 可能还没收到下线消息, 又把用户分配回本机
+    bool self = status.ok() && reply.port() == self_port &&
+                (self_host == "0.0.0.0" || reply.host() == self_host);
+
+    Json::Value rtvalue;
+    rtvalue["error"] = ErrorCodes::Success;
+    rtvalue["uid"]   = uid;
+    if (status.ok() && reply.error() == ErrorCodes::Success && !self)
+    {
+        rtvalue["host"]  = reply.host();
+        rtvalue["port"]  = reply.port();
+        rtvalue["token"] = reply.token();
+    }
+    else
+    {
+        LOG_WARN("get migrate server failed, uid: {}", uid);
+    }
+    session->Send(JsonWriter::Write(rtvalue), ID_NOTIFY_MIGRATE_REQ);
+}
+}  // namespace
+
 ChatServer::ChatServer(boost::asio::io_context& io_context, short port)
     : io_context_(io_context),
       port_(port),
       acceptor_(io_context, tcp::endpoint(tcp::v4(), port)),
-      timer_(io_context_)
-{}
+      timer_(io_context_),
+      session_count_(0),
+      published_count_(0),
+      count_timer_(io_context_),
+      draining_(false),
+      drain_stopped_(false)
+{
+    server_name_ = ConfigMgr::Inst()["SelfServer"]["Name"];
+}
 
 ChatServer::~ChatServer() { LOG_TRACE("Server dtor~"); }
 
 void ChatServer::HandleAccept(
     shared_ptr<Session> new_session, const boost::system::error_code& error)
 {
+    if (error == boost::asio::error::operation_aborted)
+    {
+        // acceptor 已关闭, 正在排空
+        return;
+    }
     if (!error)
     {
         new_session->Start();
 
         lock_guard<mutex> lock(mutex_);
 
-        sessions_.emplace(new_session->GetSessionId(), new_session);
+        if (sessions_.emplace(new_session->GetSessionId(), new_session)
+                .second)
+        {
+            session_count_++;
+        }
     }
     else
     {
@@ -60,7 +126,10 @@ void ChatServer::CleanSession(const std::string& session_id)
         UserMgr::GetInstance()->RmvUserSession(uid, session_id);
     }
 
-    sessions_.erase(session_id);
+    if (sessions_.erase(session_id) > 0)
+    {
+        session_count_--;
+    }
 }
 
 bool ChatServer::CheckValid(const std::string& session_id)
@@ -71,9 +140,13 @@ bool ChatServer::CheckValid(const std::string& session_id)
 
 void ChatServer::on_timer(const boost::system::error_code& ec)
 {
-    std::vector<std::shared_ptr<Session>> expired_sessions;
+    // 排空时计数已删除, 不能再写回 redis
+    if (ec || draining_)
+    {
+        return;
+    }
 
-    int count = 0;
+    std::vector<std::shared_ptr<Session>> expired_sessions;
 
     {
         lock_guard<mutex> lock(mutex_);
@@ -88,17 +161,19 @@ void ChatServer::on_timer(const boost::system::error_code& ec)
                 // 关闭socket, 其实这里也会触发async_read的错误处理
                 session.second->Close();
                 expired_sessions.emplace_back(session.second);
-                continue;
             }
-            count++;
         }
     }
 
-    // 设置session数量
-    auto& cfg       = ConfigMgr::Inst();
-    auto  self_name = cfg["SelfServer"]["Name"];
-    auto  count_str = std::to_string(count);
-    RedisMgr::GetInstance()->HSet(LOGIN_COUNT, self_name, count_str);
+    // 定期全量校准一次, 修正redis不可用期间丢失的增量
+    int count = session_count_;
+    RedisMgr::GetInstance()->SetCount(server_name_, count);
+    published_count_ = count;
+
+    uint64_t hits   = 0;
+    uint64_t misses = 0;
+    RedisMgr::GetInstance()->GetCacheStats(hits, misses);
+    LOG_INFO("redis local cache hits: {}, misses: {}", hits, misses);
 
     // 处理过期session, 单独提出，防止死锁
     for (auto& session : expired_sessions)
@@ -109,14 +184,151 @@ void ChatServer::on_timer(const boost::system::error_code& ec)
     start_timer();
 }
 
+void ChatServer::on_count_timer(const boost::system::error_code& ec)
+{
+    if (ec || draining_)
+    {
+        return;
+    }
+
+    // 合并周期内的所有变化, 只写一次增量
+    int count = session_count_;
+    int delta = count - published_count_;
+    if (delta != 0 &&
+        RedisMgr::GetInstance()->IncreaseCount(server_name_, delta) >= 0)
+    {
+        published_count_ = count;
+    }
+
+    start_count_timer();
+}
+
+void ChatServer::start_count_timer()
+{
+    count_timer_.expires_after(std::chrono::milliseconds(250));
+
+    auto self = shared_from_this();
+
+    count_timer_.async_wait(
+        [self](boost::system::error_code ec) { self->on_count_timer(ec); });
+}
+
 void ChatServer::Start()
 {
     LOG_INFO("Server start success, listen on port: {}", port_);
     StartAccept();
     start_timer();
+    start_count_timer();
 }
 
-void ChatServer::Shutdown() { timer_.cancel(); }
+void ChatServer::Shutdown()
+{
+    timer_.cancel();
+    count_timer_.cancel();
+
+    {
+        lock_guard<mutex> lock(drain_mutex_);
+        drain_stopped_ = true;
+    }
+    drain_cond_.notify_all();
+    if (drain_thread_.joinable() &&
+        drain_thread_.get_id() != std::this_thread::get_id())
+    {
+        drain_thread_.join();
+    }
+}
+
+void ChatServer::Drain(std::chrono::milliseconds spread,
+    std::chrono::milliseconds deadline, std::function<void()> done)
+{
+    boost::system::error_code ec;
+    acceptor_.close(ec);
+    // 停止上报登录数并删除计数, StatusServer 收到下线消息后不再分配用户到本机
+    // 已经排队的定时回调不受 cancel 影响, 由 draining_ 拦住
+    draining_ = true;
+    timer_.cancel();
+    count_timer_.cancel();
+    RedisMgr::GetInstance()->DelCount(server_name_);
+
+    drain_thread_ = std::thread([this, spread, deadline, done]() {
+        DoDrain(spread, deadline);
+        done();
+    });
+}
+
+void ChatServer::DoDrain(
+    std::chrono::milliseconds spread, std::chrono::milliseconds deadline)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::shared_ptr<Session>> sessions;
+    {
+        lock_guard<mutex> lock(mutex_);
+        for (auto& session : sessions_)
+        {
+            sessions.emplace_back(session.second);
+        }
+    }
+    LOG_INFO("drain begin, sessions: {}", sessions.size());
+
+    auto& cfg       = ConfigMgr::Inst();
+    auto  self_host = cfg["SelfServer"]["Host"];
+    auto  self_port = cfg["SelfServer"]["Port"];
+    auto  stub      = message::StatusService::NewStub(grpc::CreateChannel(
+        cfg["StatusServer"]["Host"] + ":" + cfg["StatusServer"]["Port"],
+        grpc::InsecureChannelCredentials()));
+
+    // 通知时间均匀分布在 spread 内, 避免其他节点同时涌入大量登录
+    int64_t total = sessions.size();
+    for (int64_t i = 0; i < total; ++i)
+    {
+        if (!WaitDrain(start + spread * i / total))
+        {
+            return;
+        }
+        NotifyMigrate(*stub, sessions[i], self_host, self_port);
+    }
+    sessions.clear();
+
+    // 等待客户端迁移后主动断开
+    auto until = start + std::max(spread, deadline);
+    while (std::chrono::steady_clock::now() < until)
+    {
+        {
+            lock_guard<mutex> lock(mutex_);
+            if (sessions_.empty())
+            {
+                break;
+            }
+        }
+        if (!WaitDrain(std::chrono::steady_clock::now() +
+                       std::chrono::milliseconds(100)))
+        {
+            return;
+        }
+    }
+
+    {
+        lock_guard<mutex> lock(mutex_);
+        for (auto& session : sessions_)
+        {
+            sessions.emplace_back(session.second);
+        }
+    }
+    LOG_INFO("drain finish, close remaining sessions: {}", sessions.size());
+    for (auto& session : sessions)
+    {
+        session->Close();
+        session->DealExceptionSession();
+    }
+}
+
+bool ChatServer::WaitDrain(std::chrono::steady_clock::time_point until)
+{
+    std::unique_lock<std::mutex> lock(drain_mutex_);
+    return !drain_cond_.wait_until(
+        lock, until, [this]() { return drain_stopped_; });
+}
 
 void ChatServer::start_timer()
 {
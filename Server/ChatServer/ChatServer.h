@@ -3,10 +3,15 @@
 #include "Session.h"
 
 #include <boost/asio.hpp>
+#include <atomic>
 #include <boost/asio/steady_timer.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
 #include <map>
 #include <memory.h>
 #include <mutex>
+#include <thread>
 
 using boost::asio::ip::tcp;
 
@@ -25,10 +30,20 @@ class ChatServer : public std::enable_shared_from_this<ChatServer>
 
     void Start();
     void Shutdown();
+    // 排空: 停止接受连接并从 StatusServer 摘除, 在 spread 内错开通知用户迁移
+    // 用户全部断开或超过 deadline 后在排空线程中调用 done
+    void Drain(std::chrono::milliseconds spread,
+        std::chrono::milliseconds deadline, std::function<void()> done);
 
   private:
+    void DoDrain(
+        std::chrono::milliseconds spread, std::chrono::milliseconds deadline);
+    // 等待到指定时间, Shutdown 中断时返回 false
+    bool WaitDrain(std::chrono::steady_clock::time_point until);
     void on_timer(const boost::system::error_code& ec);
     void start_timer();
+    void on_count_timer(const boost::system::error_code& ec);
+    void start_count_timer();
     void HandleAccept(
         std::shared_ptr<Session>, const boost::system::error_code& error);
     void StartAccept();
@@ -39,4 +54,15 @@ class ChatServer : public std::enable_shared_from_this<ChatServer>
     SESSION_MAP               sessions_;
     std::mutex                mutex_;
     boost::asio::steady_timer timer_;
+    // 当前session数, 由count_timer_合并后增量写入redis
+    std::atomic<int>          session_count_;
+    int                       published_count_;
+    std::string               server_name_;
+    boost::asio::steady_timer count_timer_;
+    std::atomic<bool>         draining_;
+
+    std::thread             drain_thread_;
+    std::mutex              drain_mutex_;
+    std::condition_variable drain_cond_;
+    bool                    drain_stopped_;
 };
@@ -1,4 +1,6 @@
 #include "ChatServiceImpl.h"
+#include "BaseInfoMgr.h"
+#include "JsonWriter.h"
 #include "Session.h"
 #include "Logger.h"
 #include "RedisMgr.h"
@@ -41,7 +43,7 @@ Status ChatServiceImpl::NotifyAddFriend(
     rtvalue["sex"]      = request->sex();
     rtvalue["nick"]     = request->nick();
 
-    std::string return_str = rtvalue.toStyledString();
+    std::string return_str = JsonWriter::Write(rtvalue);
     LOG_INFO("NotifyAddFriend session send begin, fromuid: {}, touid: {}",
              request->applyuid(), touid);
     session->Send(return_str, ID_NOTIFY_ADD_FRIEND_REQ);
@@ -72,6 +74,8 @@ Status ChatServiceImpl::NotifyAuthFriend(
             request->fromuid(), touid);
         return Status::OK;
     }
+    // 对方服务器刚写入好友关系, 接下来的好友列表读主库
+    session->MarkPrimaryRead();
     // 在内存中则直接发送通知对方
     Json::Value rtvalue;
     rtvalue["error"]   = ErrorCodes::Success;
@@ -93,7 +97,7 @@ Status ChatServiceImpl::NotifyAuthFriend(
         rtvalue["error"] = ErrorCodes::UidInvalid;
     }
 
-    std::string return_str = rtvalue.toStyledString();
+    std::string return_str = JsonWriter::Write(rtvalue);
     LOG_INFO("NotifyAuthFriend session send begin, fromuid: {}, touid: {}",
              request->fromuid(), touid);
     session->Send(return_str, ID_NOTIFY_AUTH_FRIEND_REQ);
@@ -136,7 +140,7 @@ Status ChatServiceImpl::NotifyTextChatMsg(::grpc::ServerContext* context,
     }
     rtvalue["text_array"] = text_array;
 
-    std::string return_str = rtvalue.toStyledString();
+    std::string return_str = JsonWriter::Write(rtvalue);
     LOG_INFO("NotifyTextChatMsg session send begin, fromuid: {}, touid: {}",
              request->fromuid(), touid);
     session->Send(return_str, ID_NOTIFY_TEXT_CHAT_MSG_REQ);
@@ -148,61 +152,8 @@ Status ChatServiceImpl::NotifyTextChatMsg(::grpc::ServerContext* context,
 bool ChatServiceImpl::GetBaseInfo(
     std::string base_key, int uid, std::shared_ptr<UserInfo>& userinfo)
 {
-    // 优先查redis中查询用户信息
-    std::string info_str = "";
-    bool        b_base   = RedisMgr::GetInstance()->Get(base_key, info_str);
-    if (b_base)
-    {
-        Json::Reader reader;
-        Json::Value  root;
-        reader.parse(info_str, root);
-        userinfo->uid_   = root["uid"].asInt();
-        userinfo->name_  = root["name"].asString();
-        userinfo->pwd_   = root["pwd"].asString();
-        userinfo->email_ = root["email"].asString();
-        userinfo->nick_  = root["nick"].asString();
-        userinfo->desc_  = root["desc"].asString();
-        userinfo->sex_   = root["sex"].asInt();
-        userinfo->icon_  = root["icon"].asString();
-        LOG_INFO("Redis get user info, uid: {}, name, {}, pwd: {}, email: {}, "
-                 "nick: {}, desc: {}, sex: {}, icon: {}",
-                 uid, userinfo->name_, userinfo->pwd_, userinfo->email_,
-                 userinfo->nick_, userinfo->desc_, userinfo->sex_, userinfo->icon_);
-    }
-    else
-    {
-        // redis中没有则查询mysql
-        // 查询数据库
-        std::shared_ptr<UserInfo> user_info = nullptr;
-        user_info = MysqlMgr::GetInstance()->GetUser(uid);
-        if (user_info == nullptr)
-        {
-            LOG_ERROR("Mysql get user info failed, uid: {}", uid);
-            return false;
-        }
-
-        LOG_INFO("Mysql get user info, uid: {}, name: {}, pwd: {}, "
-                 "email: {}, nick: {}, desc: {}, sex: {}, icon: {}",
-                 uid, user_info->name_, user_info->pwd_, user_info->email_,
-                 user_info->nick_, user_info->desc_, user_info->sex_,
-                 user_info->icon_);
-
-        userinfo = user_info;
-
-        // 将数据库内容写入redis缓存
-        Json::Value redis_root;
-        redis_root["uid"]   = uid;
-        redis_root["pwd"]   = userinfo->pwd_;
-        redis_root["name"]  = userinfo->name_;
-        redis_root["email"] = userinfo->email_;
-        redis_root["nick"]  = userinfo->nick_;
-        redis_root["desc"]  = userinfo->desc_;
-        redis_root["sex"]   = userinfo->sex_;
-        redis_root["icon"]  = userinfo->icon_;
-        RedisMgr::GetInstance()->Set(base_key, redis_root.toStyledString());
-    }
-
-    return true;
+    // 缓存读取与回写统一由BaseInfoMgr处理
+    return BaseInfoMgr::GetInstance()->GetBaseInfo(uid, userinfo);
 }
 
 Status ChatServiceImpl::NotifyKickUser(::grpc::ServerContext* context,
@@ -1,10 +1,14 @@
 #include "LogicSystem.h"
+#include "BaseInfoMgr.h"
 #include "ChatGrpcClient.h"
 #include "ChatServer.h"
 #include "ConfigMgr.h"
+#include "FriendApplyWriter.h"
+#include "JsonWriter.h"
 #include "Logger.h"
 #include "MysqlMgr.h"
 #include "RedisMgr.h"
+#include "TokenSigner.h"
 #include "UserMgr.h"
 #include "const.h"
 
@@ -129,6 +133,20 @@ void LogicSystem::RegisterCallBacks()
             placeholders::_1,
             placeholders::_2,
             placeholders::_3);
+
+    fun_callbacks_[ID_FRIEND_LIST_REQ] =
+        std::bind(&LogicSystem::FriendListHandler,
+            this,
+            placeholders::_1,
+            placeholders::_2,
+            placeholders::_3);
+
+    fun_callbacks_[ID_FRIEND_SYNC_REQ] =
+        std::bind(&LogicSystem::FriendSyncHandler,
+            this,
+            placeholders::_1,
+            placeholders::_2,
+            placeholders::_3);
 }
 
 void LogicSystem::LoginHandler(
@@ -143,27 +161,35 @@ void LogicSystem::LoginHandler(
 
     Json::Value rtvalue;
     Defer       defer([this, &rtvalue, session]() {
-        std::string return_str = rtvalue.toStyledString();
+        std::string return_str = JsonWriter::Write(rtvalue);
         session->Send(return_str, MSG_CHAT_LOGIN_RSP);
     });
 
-    // 从redis获取用户token是否正确
+    auto        server_name = ConfigMgr::Inst().GetValue("SelfServer", "Name");
     std::string uid_str     = std::to_string(uid);
-    std::string token_key   = USERTOKENPREFIX + uid_str;
-    std::string token_value = "";
-    bool        success = RedisMgr::GetInstance()->Get(token_key, token_value);
-    if (!success)
+    int         verify      = 0;
+    if (TokenSigner::GetInstance()->Enabled() &&
+        TokenSigner::GetInstance()->IsSigned(token))
+    {
+        // 签名 token 在本地校验, 不访问 redis
+        verify = TokenSigner::GetInstance()->Verify(token, uid, server_name);
+    }
+    else
+    {
+        // 从redis获取用户token是否正确, 一次脚本调用完成读取和比较
+        verify = RedisMgr::GetInstance()->VerifyToken(uid_str, token);
+    }
+    if (verify < 0)
     {
         LOG_INFO("LoginHandler user token not exist, uid: {}", uid);
         rtvalue["error"] = ErrorCodes::UidInvalid;
         return;
     }
 
-    if (token_value != token)
+    if (verify == 0)
     {
-        LOG_INFO("LoginHandler user token not match, uid: {}, token: {}, real "
-                 "token: {}",
-                 uid, token, token_value);
+        LOG_INFO("LoginHandler user token not match, uid: {}, token: {}", uid,
+                 token);
         rtvalue["error"] = ErrorCodes::TokenInvalid;
         return;
     }
@@ -189,78 +215,87 @@ void LogicSystem::LoginHandler(
     rtvalue["sex"]   = user_info->sex_;
     rtvalue["icon"]  = user_info->icon_;
 
-    // 从数据库获取申请列表
-    std::vector<std::shared_ptr<ApplyInfo>> apply_list;
+    // 先读变更版本号再读全量列表, 期间的变更会通过增量重复下发而不会丢失
+    // 各次读取可能落到延迟不同的从库, 登录时统一读主库, 保证版本号不超前于列表
+    // 后续分页和增量拉取也在窗口期内读主库
+    session->MarkPrimaryRead();
+    int64_t sync_version = 0;
+    MysqlMgr::GetInstance()->GetFriendSyncVersion(uid, sync_version, true);
+    rtvalue["sync_version"] = (Json::Int64)sync_version;
+
+    // 客户端带着本地版本号登录时跳过全量列表, 改由ID_FRIEND_SYNC_REQ拉取增量
+    auto last_version = root["sync_version"].asInt64();
+    if (last_version > 0 && last_version <= sync_version)
+    {
+        rtvalue["friend_sync"] = true;
+    }
+    else
+    {
+        // 从数据库获取申请列表
+        std::vector<std::shared_ptr<ApplyInfo>> apply_list;
 
-    auto b_apply = GetFriendApplyInfo(uid, apply_list);
+        auto b_apply = GetFriendApplyInfo(uid, apply_list, true);
 
-    if (b_apply)
-    {
-        for (auto& apply : apply_list)
+        if (b_apply)
         {
-            Json::Value obj;
-            obj["name"]   = apply->name_;
-            obj["uid"]    = apply->uid_;
-            obj["icon"]   = apply->icon_;
-            obj["nick"]   = apply->nick_;
-            obj["sex"]    = apply->sex_;
-            obj["desc"]   = apply->desc_;
-            obj["status"] = apply->status_;
-            rtvalue["apply_list"].append(obj);
+            for (auto& apply : apply_list)
+            {
+                Json::Value obj;
+                obj["name"]   = apply->name_;
+                obj["uid"]    = apply->uid_;
+                obj["icon"]   = apply->icon_;
+                obj["nick"]   = apply->nick_;
+                obj["sex"]    = apply->sex_;
+                obj["desc"]   = apply->desc_;
+                obj["status"] = apply->status_;
+                rtvalue["apply_list"].append(obj);
+            }
         }
-    }
 
-    // 获取好友列表
-    std::vector<std::shared_ptr<UserInfo>> friend_list;
-    bool b_friend_list = GetFriendList(uid, friend_list);
-    for (auto& friend_ele : friend_list)
-    {
-        Json::Value obj;
-        obj["name"] = friend_ele->name_;
-        obj["uid"]  = friend_ele->uid_;
-        obj["icon"] = friend_ele->icon_;
-        obj["nick"] = friend_ele->nick_;
-        obj["sex"]  = friend_ele->sex_;
-        obj["desc"] = friend_ele->desc_;
-        obj["back"] = friend_ele->back_;
-        rtvalue["friend_list"].append(obj);
+        // 登录只返回第一页好友和总数, 剩余页由客户端通过ID_FRIEND_LIST_REQ拉取
+        int         friend_total = 0;
+        std::string friend_etag  = "";
+        bool        b_version    = MysqlMgr::GetInstance()->GetFriendVersion(
+            uid, friend_total, friend_etag, true);
+        if (b_version)
+        {
+            rtvalue["friend_total"] = friend_total;
+            rtvalue["friend_etag"]  = friend_etag;
+        }
+        GetFriendPage(uid, 0, rtvalue, true);
     }
 
-    auto server_name = ConfigMgr::Inst().GetValue("SelfServer", "Name");
     {
-        // 此处添加分布式锁，让该线程独占登录
-        // 拼接用户ip对应的key
-        auto lock_key   = LOCK_PREFIX + uid_str;
-        auto identifier = RedisMgr::GetInstance()->acquireLock(
-            lock_key, LOCK_TIME_OUT, ACQUIRE_TIME_OUT);
-        // 利用defer解锁
-        Defer defer2([this, identifier, lock_key]() {
-            RedisMgr::GetInstance()->releaseLock(lock_key, identifier);
-        });
-        // 此处判断该用户是否在别处或者本服务器登录
+        // 同一个uid在本服务器的登录串行化, 保证redis与UserMgr中的session一致
+        // 跨服务器的竞争由ClaimLogin的原子读写处理, 不再需要分布式锁
+        std::lock_guard<std::mutex> login_lock(
+            login_mutexes_[uid % login_mutexes_.size()]);
+
+        std::string prev_server  = "";
+        std::string prev_session = "";
+        bool        b_claim      = RedisMgr::GetInstance()->ClaimLogin(uid_str,
+            server_name, session->GetSessionId(), prev_server, prev_session);
+        if (!b_claim)
+        {
+            LOG_ERROR("LoginHandler claim login failed, uid: {}", uid);
+        }
+
+        // session绑定用户uid
+        session->SetUserId(uid);
+        // uid和session绑定管理,方便以后踢人操作
+        auto old_session = UserMgr::GetInstance()->GetSession(uid);
+        UserMgr::GetInstance()->SetUserSession(uid, session);
 
-        std::string uid_ip_value = "";
-        auto        uid_ip_key   = USERIPPREFIX + uid_str;
-        bool b_ip = RedisMgr::GetInstance()->Get(uid_ip_key, uid_ip_value);
         // 说明用户已经登录了，此处应该踢掉之前的用户登录状态
-        if (b_ip)
+        if (!prev_server.empty())
         {
             LOG_INFO("LoginHandler user already login, uid: {}, ip: {}", uid,
-                     uid_ip_value);
-            // 获取当前服务器ip信息
-            auto& cfg       = ConfigMgr::Inst();
-            auto  self_name = cfg["SelfServer"]["Name"];
+                     prev_server);
             // 如果之前登录的服务器和当前相同，则直接在本服务器踢掉
-            if (uid_ip_value == self_name)
+            if (prev_server == server_name)
             {
-                LOG_INFO("LoginHandler user already login in same server, uid: "
-                         "{}, lastip: {}",
-                         uid_ip_value);
-                // 查找旧有的连接
-                auto old_session = UserMgr::GetInstance()->GetSession(uid);
-
                 // 此处应该发送踢人消息
-                if (old_session)
+                if (old_session && old_session != session)
                 {
                     LOG_INFO("LoginHandler user already login in same server, "
                              "uid: {}, old_session: {}",
@@ -275,23 +310,13 @@ void LogicSystem::LoginHandler(
                 // 如果不是本服务器，则通知grpc通知其他服务器踢掉
                 LOG_INFO("LoginHandler user already login in other server, "
                          "uid: {}, lastip: {}",
-                         uid, uid_ip_value);
+                         uid, prev_server);
                 KickUserReq kick_req;
                 kick_req.set_uid(uid);
                 ChatGrpcClient::GetInstance()->NotifyKickUser(
-                    uid_ip_value, kick_req);
+                    prev_server, kick_req);
             }
         }
-
-        // session绑定用户uid
-        session->SetUserId(uid);
-        // 为用户设置登录ip server的名字
-        std::string ipkey = USERIPPREFIX + uid_str;
-        RedisMgr::GetInstance()->Set(ipkey, server_name);
-        // uid和session绑定管理,方便以后踢人操作
-        UserMgr::GetInstance()->SetUserSession(uid, session);
-        std::string uid_session_key = USER_SESSION_PREFIX + uid_str;
-        RedisMgr::GetInstance()->Set(uid_session_key, session->GetSessionId());
     }
 
     return;
@@ -309,7 +334,7 @@ void LogicSystem::SearchInfo(
     Json::Value rtvalue;
 
     Defer defer([this, &rtvalue, session]() {
-        std::string return_str = rtvalue.toStyledString();
+        std::string return_str = JsonWriter::Write(rtvalue);
         session->Send(return_str, ID_SEARCH_USER_RSP);
     });
 
@@ -343,12 +368,15 @@ void LogicSystem::AddFriendApply(
     Json::Value rtvalue;
     rtvalue["error"] = ErrorCodes::Success;
     Defer defer([this, &rtvalue, session]() {
-        std::string return_str = rtvalue.toStyledString();
+        std::string return_str = JsonWriter::Write(rtvalue);
         session->Send(return_str, ID_ADD_FRIEND_RSP);
     });
 
-    // 先更新数据库
-    MysqlMgr::GetInstance()->AddFriendApply(uid, touid);
+    // 申请写入写后队列即可回复, 由后台批量落库, 队列不可用时同步写库
+    if (!FriendApplyWriter::GetInstance()->Enqueue(uid, touid))
+    {
+        MysqlMgr::GetInstance()->AddFriendApply(uid, touid);
+    }
 
     // 查询redis 查找touid对应的server ip
     auto        to_str      = std::to_string(touid);
@@ -390,7 +418,7 @@ void LogicSystem::AddFriendApply(
                 notify["sex"]  = apply_info->sex_;
                 notify["nick"] = apply_info->nick_;
             }
-            std::string return_str = notify.toStyledString();
+            std::string return_str = JsonWriter::Write(notify);
             session->Send(return_str, ID_NOTIFY_ADD_FRIEND_REQ);
         }
 
@@ -434,11 +462,12 @@ void LogicSystem::AuthFriendApply(
 
     Json::Value rtvalue;
     rtvalue["error"] = ErrorCodes::Success;
-    auto user_info   = std::make_shared<UserInfo>();
 
-    std::string base_key = USER_BASE_INFO + std::to_string(touid);
-    bool        b_info   = GetBaseInfo(base_key, touid, user_info);
-    if (b_info)
+    // 双方信息一次批量获取, 通知对方时直接复用
+    std::unordered_map<int, std::shared_ptr<UserInfo>> infos;
+    BaseInfoMgr::GetInstance()->GetBaseInfos({touid, uid}, infos);
+    auto user_info = infos[touid];
+    if (user_info)
     {
         rtvalue["name"] = user_info->name_;
         rtvalue["nick"] = user_info->nick_;
@@ -452,7 +481,7 @@ void LogicSystem::AuthFriendApply(
     }
 
     Defer defer([this, &rtvalue, session]() {
-        std::string return_str = rtvalue.toStyledString();
+        std::string return_str = JsonWriter::Write(rtvalue);
         session->Send(return_str, ID_AUTH_FRIEND_RSP);
     });
 
@@ -461,6 +490,7 @@ void LogicSystem::AuthFriendApply(
 
     // 更新数据库添加好友
     MysqlMgr::GetInstance()->AddFriend(uid, touid, back_name);
+    session->MarkPrimaryRead();
 
     // 查询redis 查找touid对应的server ip
     auto        to_str      = std::to_string(touid);
@@ -487,25 +517,24 @@ void LogicSystem::AuthFriendApply(
                      uid, touid);
             // 在内存中则直接发送通知对方
             Json::Value notify;
-            notify["error"]       = ErrorCodes::Success;
-            notify["fromuid"]     = uid;
-            notify["touid"]       = touid;
-            std::string base_key  = USER_BASE_INFO + std::to_string(uid);
-            auto        user_info = std::make_shared<UserInfo>();
-            bool        b_info    = GetBaseInfo(base_key, uid, user_info);
-            if (b_info)
+            notify["error"]   = ErrorCodes::Success;
+            notify["fromuid"] = uid;
+            notify["touid"]   = touid;
+            auto from_info    = infos[uid];
+            if (from_info)
             {
-                notify["name"] = user_info->name_;
-                notify["nick"] = user_info->nick_;
-                notify["icon"] = user_info->icon_;
-                notify["sex"]  = user_info->sex_;
+                notify["name"] = from_info->name_;
+                notify["nick"] = from_info->nick_;
+                notify["icon"] = from_info->icon_;
+                notify["sex"]  = from_info->sex_;
             }
             else
             {
                 notify["error"] = ErrorCodes::UidInvalid;
             }
 
-            std::string return_str = notify.toStyledString();
+            std::string return_str = JsonWriter::Write(notify);
+            session->MarkPrimaryRead();
             session->Send(return_str, ID_NOTIFY_AUTH_FRIEND_REQ);
         }
 
@@ -542,7 +571,7 @@ void LogicSystem::DealChatTextMsg(
     rtvalue["touid"]      = touid;
 
     Defer defer([this, &rtvalue, session]() {
-        std::string return_str = rtvalue.toStyledString();
+        std::string return_str = JsonWriter::Write(rtvalue);
         session->Send(return_str, ID_TEXT_CHAT_MSG_RSP);
     });
 
@@ -570,7 +599,7 @@ void LogicSystem::DealChatTextMsg(
                      "touid: {}, session: {}, peer: {}",
                      uid, touid, session->GetSessionId(), peer->GetSessionId());
             // 在内存中则直接发送通知对方
-            std::string msg = rtvalue.toStyledString();
+            std::string msg = JsonWriter::Write(rtvalue);
             peer->Send(msg, ID_NOTIFY_TEXT_CHAT_MSG_REQ);
         }
 
@@ -611,7 +640,103 @@ void LogicSystem::HeartBeatHandler(
     LOG_INFO("recv heart msg, uid: {}", uid);
     Json::Value rtvalue;
     rtvalue["error"] = ErrorCodes::Success;
-    session->Send(rtvalue.toStyledString(), ID_HEARTBEAT_RSP);
+    session->Send(JsonWriter::Write(rtvalue), ID_HEARTBEAT_RSP);
+}
+
+void LogicSystem::FriendListHandler(
+    SessionPtr session, const short& msg_id, const string& msg_data)
+{
+    Json::Reader reader;
+    Json::Value  root;
+    reader.parse(msg_data, root);
+    // 只允许拉取当前登录用户自己的好友列表
+    auto uid    = session->GetUserId();
+    auto cursor = root["cursor"].asInt();
+    auto etag   = root["etag"].asString();
+    LOG_INFO("user get friend list, uid: {}, cursor: {}", uid, cursor);
+
+    Json::Value rtvalue;
+    Defer       defer([&rtvalue, session]() {
+        std::string return_str = JsonWriter::Write(rtvalue);
+        session->Send(return_str, ID_FRIEND_LIST_RSP);
+    });
+
+    int         total    = 0;
+    std::string cur_etag = "";
+    bool        primary  = session->ReadPrimary();
+    if (!MysqlMgr::GetInstance()->GetFriendVersion(
+            uid, total, cur_etag, primary))
+    {
+        rtvalue["error"] = ErrorCodes::RPCFailed;
+        return;
+    }
+
+    rtvalue["error"]  = ErrorCodes::Success;
+    rtvalue["uid"]    = uid;
+    rtvalue["total"]  = total;
+    rtvalue["etag"]   = cur_etag;
+    rtvalue["cursor"] = cursor;
+
+    // 从头拉取且版本未变, 客户端沿用本地列表
+    if (cursor == 0 && !etag.empty() && etag == cur_etag)
+    {
+        rtvalue["unchanged"] = true;
+        return;
+    }
+
+    if (!GetFriendPage(uid, cursor, rtvalue, primary))
+    {
+        rtvalue["error"] = ErrorCodes::RPCFailed;
+    }
+}
+
+void LogicSystem::FriendSyncHandler(
+    SessionPtr session, const short& msg_id, const string& msg_data)
+{
+    Json::Reader reader;
+    Json::Value  root;
+    reader.parse(msg_data, root);
+    auto uid     = session->GetUserId();
+    auto version = root["version"].asInt64();
+    LOG_INFO("user sync friend changes, uid: {}, version: {}", uid, version);
+
+    Json::Value rtvalue;
+    Defer       defer([&rtvalue, session]() {
+        std::string return_str = JsonWriter::Write(rtvalue);
+        session->Send(return_str, ID_FRIEND_SYNC_RSP);
+    });
+
+    std::vector<FriendChange> changes;
+    bool                      more = false;
+    bool b_sync = MysqlMgr::GetInstance()->GetFriendChanges(
+        uid, version, FRIEND_PAGE_SIZE, changes, more, session->ReadPrimary());
+    if (!b_sync)
+    {
+        rtvalue["error"] = ErrorCodes::RPCFailed;
+        return;
+    }
+
+    rtvalue["error"] = ErrorCodes::Success;
+    rtvalue["uid"]   = uid;
+    for (auto& change : changes)
+    {
+        Json::Value obj;
+        obj["version"] = (Json::Int64)change.version_;
+        obj["op"]      = change.op_;
+        obj["status"]  = change.status_;
+        obj["uid"]     = change.peer_.uid_;
+        obj["name"]    = change.peer_.name_;
+        obj["icon"]    = change.peer_.icon_;
+        obj["nick"]    = change.peer_.nick_;
+        obj["sex"]     = change.peer_.sex_;
+        obj["desc"]    = change.peer_.desc_;
+        obj["back"]    = change.peer_.back_;
+        rtvalue["changes"].append(obj);
+        version = change.version_;
+    }
+    // 客户端保存返回的版本号, more为true时继续拉取
+    rtvalue["version"] = (Json::Int64)version;
+    rtvalue["more"]    = more;
 }
 
 bool LogicSystem::isPureDigit(const std::string& str)
@@ -695,7 +820,7 @@ void LogicSystem::GetUserByUid(std::string uid_str, Json::Value& rtvalue)
     redis_root["sex"]   = user_info->sex_;
     redis_root["icon"]  = user_info->icon_;
 
-    RedisMgr::GetInstance()->Set(base_key, redis_root.toStyledString());
+    RedisMgr::GetInstance()->Set(base_key, JsonWriter::Write(redis_root));
 
     // 返回数据
     rtvalue["uid"]   = user_info->uid_;
@@ -771,7 +896,7 @@ void LogicSystem::GetUserByName(std::string name, Json::Value& rtvalue)
     redis_root["desc"]  = user_info->desc_;
     redis_root["sex"]   = user_info->sex_;
 
-    RedisMgr::GetInstance()->Set(base_key, redis_root.toStyledString());
+    RedisMgr::GetInstance()->Set(base_key, JsonWriter::Write(redis_root));
 
     // 返回数据
     rtvalue["uid"]   = user_info->uid_;
@@ -786,72 +911,42 @@ void LogicSystem::GetUserByName(std::string name, Json::Value& rtvalue)
 bool LogicSystem::GetBaseInfo(
     std::string base_key, int uid, std::shared_ptr<UserInfo>& userinfo)
 {
-    // 优先查redis中查询用户信息
-    std::string info_str = "";
-    bool        b_base   = RedisMgr::GetInstance()->Get(base_key, info_str);
-    if (b_base)
-    {
-        Json::Reader reader;
-        Json::Value  root;
-        reader.parse(info_str, root);
-        userinfo->uid_   = root["uid"].asInt();
-        userinfo->name_  = root["name"].asString();
-        userinfo->pwd_   = root["pwd"].asString();
-        userinfo->email_ = root["email"].asString();
-        userinfo->nick_  = root["nick"].asString();
-        userinfo->desc_  = root["desc"].asString();
-        userinfo->sex_   = root["sex"].asInt();
-        userinfo->icon_  = root["icon"].asString();
-        LOG_INFO("Redis get user info succeed, uid: {}, name: {}, pwd: {}, "
-                 "email: {}, icon: {}",
-                 userinfo->uid_, userinfo->name_, userinfo->pwd_, userinfo->email_,
-                 userinfo->icon_);
-    }
-    else
-    {
-        // redis中没有则查询mysql
-        // 查询数据库
-        std::shared_ptr<UserInfo> user_info = nullptr;
-        user_info = MysqlMgr::GetInstance()->GetUser(uid);
-        if (user_info == nullptr)
-        {
-            LOG_ERROR("Mysql get user info failed, uid: {}", uid);
-            return false;
-        }
-
-        LOG_INFO("Mysql get user info succeed, uid: {}, name: {}, pwd: {}, "
-                 "email: {}, icon: {}",
-                 user_info->uid_, user_info->name_, user_info->pwd_,
-                 user_info->email_, user_info->icon_);
-
-        userinfo = user_info;
-
-        // 将数据库内容写入redis缓存
-        Json::Value redis_root;
-        redis_root["uid"]   = uid;
-        redis_root["pwd"]   = userinfo->pwd_;
-        redis_root["name"]  = userinfo->name_;
-        redis_root["email"] = userinfo->email_;
-        redis_root["nick"]  = userinfo->nick_;
-        redis_root["desc"]  = userinfo->desc_;
-        redis_root["sex"]   = userinfo->sex_;
-        redis_root["icon"]  = userinfo->icon_;
-        RedisMgr::GetInstance()->Set(base_key, redis_root.toStyledString());
-    }
-
-    return true;
+    // 缓存读取与回写统一由BaseInfoMgr处理
+    return BaseInfoMgr::GetInstance()->GetBaseInfo(uid, userinfo);
 }
 
 bool LogicSystem::GetFriendApplyInfo(
-    int to_uid, std::vector<std::shared_ptr<ApplyInfo>>& list)
+    int to_uid, std::vector<std::shared_ptr<ApplyInfo>>& list, bool primary)
 {
     // 从mysql获取好友申请列表
-    return MysqlMgr::GetInstance()->GetApplyList(to_uid, list, 0, 10);
+    return MysqlMgr::GetInstance()->GetApplyList(to_uid, list, 0, 10, primary);
 }
 
-bool LogicSystem::GetFriendList(
-    int self_id, std::vector<std::shared_ptr<UserInfo>>& user_list)
+bool LogicSystem::GetFriendPage(
+    int self_id, int after_id, Json::Value& rtvalue, bool primary)
 {
-    // 从mysql获取好友列表
-    return MysqlMgr::GetInstance()->GetFriendList(self_id, user_list);
+    // 从mysql按游标获取一页好友
+    std::vector<std::shared_ptr<UserInfo>> friend_list;
+    int                                    next_id = 0;
+    bool b_page = MysqlMgr::GetInstance()->GetFriendPage(
+        self_id, after_id, FRIEND_PAGE_SIZE, friend_list, next_id, primary);
+    if (!b_page)
+    {
+        return false;
+    }
+
+    for (auto& friend_ele : friend_list)
+    {
+        Json::Value obj;
+        obj["name"] = friend_ele->name_;
+        obj["uid"]  = friend_ele->uid_;
+        obj["icon"] = friend_ele->icon_;
+        obj["nick"] = friend_ele->nick_;
+        obj["sex"]  = friend_ele->sex_;
+        obj["desc"] = friend_ele->desc_;
+        obj["back"] = friend_ele->back_;
+        rtvalue["friend_list"].append(obj);
+    }
+    rtvalue["friend_next"] = next_id;
+    return true;
 }
@@ -3,6 +3,7 @@
 #include "Singleton.h"
 #include "data.h"
 
+#include <array>
 #include <functional>
 #include <jsoncpp/json/json.h>
 #include <jsoncpp/json/reader.h>
@@ -42,15 +43,19 @@ class LogicSystem : public Singleton<LogicSystem>
         SessionPtr session, const short& msg_id, const string& msg_data);
     void HeartBeatHandler(
         SessionPtr session, const short& msg_id, const string& msg_data);
+    void FriendListHandler(
+        SessionPtr session, const short& msg_id, const string& msg_data);
+    void FriendSyncHandler(
+        SessionPtr session, const short& msg_id, const string& msg_data);
     bool isPureDigit(const std::string& str);
     void GetUserByUid(std::string uid_str, Json::Value& rtvalue);
     void GetUserByName(std::string name, Json::Value& rtvalue);
     bool GetBaseInfo(
         std::string base_key, int uid, std::shared_ptr<UserInfo>& userinfo);
-    bool GetFriendApplyInfo(
-        int to_uid, std::vector<std::shared_ptr<ApplyInfo>>& list);
-    bool GetFriendList(
-        int self_id, std::vector<std::shared_ptr<UserInfo>>& user_list);
+    bool GetFriendApplyInfo(int to_uid,
+        std::vector<std::shared_ptr<ApplyInfo>>& list, bool primary = false);
+    bool GetFriendPage(int self_id, int after_id, Json::Value& rtvalue,
+        bool primary = false);
     std::vector<std::thread>           threads_;
     std::vector<shared_ptr<LogicNode>> msg_que_;
     std::mutex                         mutex_;
@@ -58,4 +63,6 @@ class LogicSystem : public Singleton<LogicSystem>
     bool                               stopped_;
     std::map<short, FunCallBack>       fun_callbacks_;
     std::shared_ptr<ChatServer>        server_;
+    // 按uid分段的本地登录锁
+    std::array<std::mutex, 64> login_mutexes_;
 };
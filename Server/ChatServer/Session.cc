@@ -1,5 +1,6 @@
 #include "Session.h"
 #include "ChatServer.h"
+#include "JsonWriter.h"
 #include "Logger.h"
 #include "LogicSystem.h"
 #include "RedisMgr.h"
@@ -13,7 +14,8 @@ Session::Session(boost::asio::io_context& io_context, ChatServer* server)
       server_(server),
       closed_(false),
       head_parse_(false),
-      user_uid_(0)
+      user_uid_(0),
+      primary_until_(0)
 {
     boost::uuids::uuid a_uuid = boost::uuids::random_generator()();
     session_id_               = boost::uuids::to_string(a_uuid);
@@ -298,7 +300,7 @@ void Session::NotifyOffline(int uid)
     rtvalue["error"] = ErrorCodes::Success;
     rtvalue["uid"]   = uid;
 
-    std::string return_str = rtvalue.toStyledString();
+    std::string return_str = JsonWriter::Write(rtvalue);
     LOG_INFO("session: {} notify offline, uid: {}", session_id_, uid);
     Send(return_str, ID_NOTIFY_OFF_LINE_REQ);
     return;
@@ -323,55 +325,29 @@ bool Session::IsHeartbeatExpired(std::time_t& now)
 
 void Session::UpdateHeartbeat() { last_heartbeat_ = std::time(nullptr); }
 
-void Session::DealExceptionSession()
+void Session::MarkPrimaryRead()
 {
-    auto self = shared_from_this();
-    // 加锁清除session
-    auto uid_str  = std::to_string(user_uid_);
-    auto lock_key = LOCK_PREFIX + uid_str;
-
-    LOG_INFO("Redis get user lock begin, session: {}, key: {}", session_id_,
-             lock_key);
-
-    auto identifier = RedisMgr::GetInstance()->acquireLock(
-        lock_key, LOCK_TIME_OUT, ACQUIRE_TIME_OUT);
+    // 从库延迟一般在秒级, 留出足够余量
+    primary_until_ = std::time(nullptr) + 5;
+}
 
-    LOG_INFO("Redis get user lock finish, session: {}, key: {}", session_id_,
-             lock_key);
+bool Session::ReadPrimary() { return std::time(nullptr) < primary_until_; }
 
-    Defer defer([identifier, lock_key, self, this]() {
-        server_->CleanSession(session_id_);
-        RedisMgr::GetInstance()->releaseLock(lock_key, identifier);
-    });
+void Session::DealExceptionSession()
+{
+    auto self    = shared_from_this();
+    auto uid_str = std::to_string(user_uid_);
 
-    if (identifier.empty())
-    {
-        LOG_INFO("Redis get redis user lock failed, session: {}, key: {}",
-                 session_id_, lock_key);
-        return;
-    }
-    std::string redis_session_id = "";
-    auto        bsuccess         = RedisMgr::GetInstance()->Get(
-        USER_SESSION_PREFIX + uid_str, redis_session_id);
-    if (!bsuccess)
-    {
-        LOG_ERROR("Redis get session id failed, session: {}, key: {}",
-                  session_id_, USER_SESSION_PREFIX + uid_str);
-        return;
-    }
+    Defer defer([self, this]() { server_->CleanSession(session_id_); });
 
-    if (redis_session_id != session_id_)
+    // 只有redis中记录的仍是本session时才清除, 否则说明用户已在别处重新登录
+    if (!RedisMgr::GetInstance()->ReleaseLogin(uid_str, session_id_))
     {
-        // 说明有客户在其他服务器异地登录了
-        LOG_INFO("new session established, uid: {}, old session: {}, "
-                 "redis_session: {}",
-                 user_uid_, session_id_, redis_session_id);
+        LOG_INFO("new session established or trace cleared, uid: {}, "
+                 "session: {}",
+                 user_uid_, session_id_);
         return;
     }
 
     LOG_INFO("Redis clear user login trace, uid: {}", user_uid_);
-
-    RedisMgr::GetInstance()->Del(USER_SESSION_PREFIX + uid_str);
-    // 清除用户登录信息
-    RedisMgr::GetInstance()->Del(USERIPPREFIX + uid_str);
 }
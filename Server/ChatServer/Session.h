@@ -46,6 +46,9 @@ class Session : public std::enable_shared_from_this<Session>
 
     // 更新心跳
     void UpdateHeartbeat();
+    // 好友关系写入后一段时间内读主库, 避免从库复制延迟读到旧数据
+    void MarkPrimaryRead();
+    bool ReadPrimary();
     // 处理异常连接
     void DealExceptionSession();
 
@@ -76,6 +79,8 @@ class Session : public std::enable_shared_from_this<Session>
     int                      user_uid_;
     // 记录上次接受数据的时间
     std::atomic<time_t> last_heartbeat_;
+    // 在此时间之前的好友数据读主库
+    std::atomic<time_t> primary_until_;
     // session 锁
     std::mutex session_mutex_;
 };
@@ -2,6 +2,7 @@
 #include "ChatServer.h"
 #include "ChatServiceImpl.h"
 #include "ConfigMgr.h"
+#include "FriendApplyWriter.h"
 #include "Logger.h"
 #include "LogicSystem.h"
 #include "RedisMgr.h"
@@ -18,12 +19,15 @@ int main()
     {
         auto pool = AsioIOServicePool::GetInstance();
         // 将登录数设置为0
-        RedisMgr::GetInstance()->HSet(LOGIN_COUNT, server_name, "0");
+        RedisMgr::GetInstance()->InitCount(server_name);
 
         Defer derfer([server_name]() {
-            RedisMgr::GetInstance()->HDel(LOGIN_COUNT, server_name);
+            RedisMgr::GetInstance()->DelCount(server_name);
         });
 
+        // 好友申请写后队列, 以服务器名作为消费者名
+        FriendApplyWriter::GetInstance()->Start(server_name);
+
         boost::asio::io_context io_context;
 
         auto port_str = cfg["SelfServer"]["Port"];
@@ -50,8 +54,7 @@ int main()
         // 单独启动一个线程处理grpc服务
         std::thread grpc_server_thread([&server]() { server->Wait(); });
 
-        boost::asio::signal_set signals(io_context, SIGINT, SIGTERM);
-        signals.async_wait([&io_context, pool, &cserver, &server](auto, auto) {
+        auto stop = [&io_context, pool, &cserver, &server]() {
             LOG_INFO("Stopping server...");
             // FIXME(yinghaoyu):
             // 这里timer.cancel()与io_context.stop()在Windows和Linux表现不一样
@@ -61,6 +64,25 @@ int main()
             pool->Stop();
             server->Shutdown();
             LogicSystem::GetInstance()->Shutdown();
+            FriendApplyWriter::GetInstance()->Stop();
+        };
+
+        // 排空参数(秒): 迁移通知的分散时间, 以及等待用户断开的最长时间
+        auto spread_str   = cfg["SelfServer"]["MigrateSpread"];
+        auto deadline_str = cfg["SelfServer"]["DrainTimeout"];
+        auto spread       = std::chrono::seconds(
+            spread_str.empty() ? 10 : stoi(spread_str));
+        auto deadline = std::chrono::seconds(
+            deadline_str.empty() ? 30 : stoi(deadline_str));
+
+        // 第一次收到信号时排空, 排空期间再次收到信号则立即退出
+        boost::asio::signal_set signals(io_context, SIGINT, SIGTERM);
+        signals.async_wait([&, stop](auto, auto) {
+            LOG_INFO("Draining server...");
+            cserver->Drain(spread, deadline, [&io_context, stop]() {
+                boost::asio::post(io_context, stop);
+            });
+            signals.async_wait([stop](auto, auto) { stop(); });
         });
 
         // 将Cserver注册给逻辑类方便以后清除连接
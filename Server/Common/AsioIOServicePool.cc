@@ -1,12 +1,30 @@
 ﻿#include "AsioIOServicePool.h"
+#include "ConfigMgr.h"
 
 #include <iostream>
 
 using namespace std;
 
-AsioIOServicePool::AsioIOServicePool(std::size_t size)
-    : ioServices_(size), workGuards_(size), nextIOService_(0)
+namespace
 {
+std::size_t PoolSize()
+{
+    std::string size = ConfigMgr::Inst()["IOServicePool"]["Size"];
+    if (size.empty())
+    {
+        return 2;
+    }
+    // 0 表示按 CPU 核数启动
+    std::size_t n = stoul(size);
+    return n > 0 ? n : std::max(1u, std::thread::hardware_concurrency());
+}
+}  // namespace
+
+AsioIOServicePool::AsioIOServicePool()
+    : ioServices_(PoolSize()), workGuards_(ioServices_.size()),
+      nextIOService_(0)
+{
+    std::size_t size = ioServices_.size();
     for (std::size_t i = 0; i < size; ++i)
     {
         // 使用 make_work_guard 创建 WorkGuard
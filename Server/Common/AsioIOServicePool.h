@@ -24,8 +24,8 @@ class AsioIOServicePool : public Singleton<AsioIOServicePool>
     void                     Stop();
 
   private:
-    AsioIOServicePool(
-        std::size_t size = 2 /* std::thread::hardware_concurrency() */);
+    // 线程数取自 [IOServicePool] Size, 未配置时为 2
+    AsioIOServicePool();
     std::vector<IOService>    ioServices_;
     std::vector<WorkGuardPtr> workGuards_;
     std::vector<std::thread>  threads_;
@@ -1,14 +1,49 @@
 #include "DistLock.h"
+#include "ConfigMgr.h"
+#include "RedisScript.h"
+#include "RedisSubscriber.h"
+#include "const.h"
 
+#include <algorithm>
 #include <boost/uuid/uuid.hpp>
 #include <boost/uuid/uuid_generators.hpp>
 #include <boost/uuid/uuid_io.hpp>
 #include <chrono>
 #include <cstdlib>
+#include <cstring>
 #include <hiredis/hiredis.h>
+#include <random>
 #include <string>
 #include <thread>
 
+// 加锁成功后自增全局 fence 并返回, 失败返回 0
+static RedisScript kAcquireScript(
+    "if redis.call('set', KEYS[1], ARGV[1], 'NX', 'EX', ARGV[2]) then "
+    "  return redis.call('incr', KEYS[2]) "
+    "end "
+    "return 0");
+
+// 判断锁标识是否匹配，匹配则删除锁并通知等待者
+static RedisScript kReleaseScript(
+    "if redis.call('get', KEYS[1]) == ARGV[1] then "
+    "  redis.call('del', KEYS[1]) "
+    "  redis.call('publish', ARGV[2], '1') "
+    "  return 1 "
+    "end "
+    "return 0");
+
+// 判断锁标识是否匹配，匹配则重置过期时间
+static RedisScript kRenewScript(
+    "if redis.call('get', KEYS[1]) == ARGV[1] then "
+    "  return redis.call('expire', KEYS[1], ARGV[2]) "
+    "end "
+    "return 0");
+
+// 退避的初始和最大等待时间(毫秒)
+// 最大值同时兜底了锁超时过期这种不会发布事件的情况
+static const int kBackoffInitMs = 1;
+static const int kBackoffMaxMs  = 50;
+
 // 定义单例模式
 DistLock& DistLock::Inst()
 {
@@ -16,6 +51,14 @@ DistLock& DistLock::Inst()
     return lock;
 }
 
+DistLock::~DistLock()
+{
+    if (subscriber_)
+    {
+        subscriber_->Stop();
+    }
+}
+
 // 使用 Boost UUID 生成全局唯一标识符（UUID）
 static std::string generateUUID()
 {
@@ -23,33 +66,106 @@ static std::string generateUUID()
     return to_string(uuid);
 }
 
+void DistLock::startSubscriber()
+{
+    auto& gCfgMgr = ConfigMgr::Inst();
+    auto  host    = gCfgMgr["Redis"]["Host"];
+    auto  port    = gCfgMgr["Redis"]["Port"];
+    auto  pwd     = gCfgMgr["Redis"]["Passwd"];
+    subscriber_.reset(new RedisSubscriber(host, stoi(port), pwd));
+    subscriber_->PSubscribe(std::string(LOCK_EVENT_PREFIX) + "*",
+        [this](const std::string& channel, const std::string&) {
+            onRelease(channel);
+        });
+    subscriber_->Start();
+}
+
+void DistLock::onRelease(const std::string& channel)
+{
+    auto lockName = channel.substr(strlen(LOCK_EVENT_PREFIX));
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto                        it = slots_.find(lockName);
+    // 本进程没有等待者则忽略
+    if (it == slots_.end())
+    {
+        return;
+    }
+    it->second.gen++;
+    cond_.notify_all();
+}
+
+bool DistLock::tryAcquire(IRedis::ptr connect, const std::string& lockKey,
+    const std::string& identifier, int lockTimeout, int64_t* fence)
+{
+    auto reply = kAcquireScript.exec(connect,
+        {lockKey, LOCK_FENCE},
+        {identifier, std::to_string(lockTimeout)});
+    if (reply == nullptr || reply->type != REDIS_REPLY_INTEGER ||
+        reply->integer <= 0)
+    {
+        return false;
+    }
+    if (fence != nullptr)
+    {
+        *fence = reply->integer;
+    }
+    return true;
+}
+
 // 尝试获取锁，返回锁的唯一标识符（UUID），如果获取失败则返回空字符串
 std::string DistLock::acquireLock(IRedis::ptr connect,
-    const std::string& lockName, int lockTimeout, int acquireTimeout)
+    const std::string& lockName, int lockTimeout, int acquireTimeout,
+    int64_t* fence)
 {
     std::string identifier = generateUUID();
     std::string lockKey    = "lock:" + lockName;
-    auto        endTime =
+
+    // 无竞争时一次往返即可拿到锁
+    if (tryAcquire(connect, lockKey, identifier, lockTimeout, fence))
+    {
+        return identifier;
+    }
+
+    std::call_once(sub_once_, [this]() { startSubscriber(); });
+
+    auto endTime =
         std::chrono::steady_clock::now() + std::chrono::seconds(acquireTimeout);
 
+    thread_local std::mt19937 rng(std::random_device{}());
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto&                        slot = slots_[lockName];
+    slot.waiters++;
+    Defer defer([this, &lockName, &slot]() {
+        // 最后一个等待者负责清理
+        if (--slot.waiters == 0)
+        {
+            slots_.erase(lockName);
+        }
+    });
+
+    int backoff = kBackoffInitMs;
     while (std::chrono::steady_clock::now() < endTime)
     {
-        // 使用 SET 命令尝试加锁：SET lockKey identifier NX EX lockTimeout
-        auto reply = connect->cmd("SET %s %s NX EX %d",
-            lockKey.c_str(),
-            identifier.c_str(),
-            lockTimeout);
-        if (reply != nullptr)
+        // 先记下事件代数, 避免在尝试加锁期间错过释放通知
+        uint64_t gen = slot.gen;
+        lock.unlock();
+        bool ok = tryAcquire(connect, lockKey, identifier, lockTimeout, fence);
+        lock.lock();
+        if (ok)
         {
-            // 判断返回结果是否为 OK
-            if (reply->type == REDIS_REPLY_STATUS &&
-                std::string(reply->str) == "OK")
-            {
-                return identifier;
-            }
+            return identifier;
         }
-        // 暂停 1 毫秒后重试，防止忙等待
-        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+        // 加入随机抖动, 防止多个等待者同时醒来再次冲突
+        std::uniform_int_distribution<int> dist(backoff / 2, backoff);
+        auto wait  = std::chrono::milliseconds(std::max(1, dist(rng)));
+        auto until = std::min(std::chrono::steady_clock::now() + wait, endTime);
+        cond_.wait_until(
+            lock, until, [&slot, gen]() { return slot.gen != gen; });
+
+        backoff = std::min(backoff * 2, kBackoffMaxMs);
     }
     return "";
 }
@@ -59,16 +175,9 @@ bool DistLock::releaseLock(IRedis::ptr connect, const std::string& lockName,
     const std::string& identifier)
 {
     std::string lockKey = "lock:" + lockName;
-    // Lua 脚本：判断锁标识是否匹配，匹配则删除锁
-    const char* luaScript = "if redis.call('get', KEYS[1]) == ARGV[1] then \
-                                return redis.call('del', KEYS[1]) \
-                             else \
-                                return 0 \
-                             end";
-    // 调用 EVAL 命令执行 Lua 脚本，第一个参数为脚本，后面依次为 key 的数量、key
-    // 以及对应的参数
-    auto reply = connect->cmd(
-        "EVAL %s 1 %s %s", luaScript, lockKey.c_str(), identifier.c_str());
+    std::string channel = LOCK_EVENT_PREFIX + lockName;
+    // 通过 EVALSHA 执行 Lua 脚本，不再每次发送脚本原文
+    auto reply = kReleaseScript.exec(connect, {lockKey}, {identifier, channel});
     bool success = false;
     if (reply != nullptr)
     {
@@ -80,3 +189,13 @@ bool DistLock::releaseLock(IRedis::ptr connect, const std::string& lockName,
     }
     return success;
 }
+
+bool DistLock::renewLock(IRedis::ptr connect, const std::string& lockName,
+    const std::string& identifier, int lockTimeout)
+{
+    std::string lockKey = "lock:" + lockName;
+    auto        reply   = kRenewScript.exec(
+        connect, {lockKey}, {identifier, std::to_string(lockTimeout)});
+    return reply != nullptr && reply->type == REDIS_REPLY_INTEGER &&
+           reply->integer == 1;
+}
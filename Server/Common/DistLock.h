@@ -2,18 +2,50 @@
 
 #include "redis.h"
 
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+
+class RedisSubscriber;
+
+// 基于 redis 的分布式锁
+// 获取锁时返回单调递增的 fence, 写入方可以据此拒绝过期持有者的写入
+// 等待锁时使用指数退避, 并订阅释放事件提前唤醒, 避免空转轮询
 class DistLock
 {
   public:
     static DistLock& Inst();
-    ~DistLock() = default;
+    ~DistLock();
     std::string acquireLock(IRedis::ptr connect, const std::string& lockName,
-        int lockTimeout, int acquireTimeout);
+        int lockTimeout, int acquireTimeout, int64_t* fence = nullptr);
 
     bool releaseLock(IRedis::ptr connect, const std::string& lockName,
         const std::string& identifier);
 
+    // 续约, 只有锁的持有者才能续约
+    bool renewLock(IRedis::ptr connect, const std::string& lockName,
+        const std::string& identifier, int lockTimeout);
+
   private:
     DistLock() = default;
+
+    struct WaitSlot
+    {
+        int      waiters = 0;
+        uint64_t gen     = 0;
+    };
+
+    bool tryAcquire(IRedis::ptr connect, const std::string& lockKey,
+        const std::string& identifier, int lockTimeout, int64_t* fence);
+    void startSubscriber();
+    void onRelease(const std::string& channel);
+
+    std::once_flag                   sub_once_;
+    std::unique_ptr<RedisSubscriber> subscriber_;
+
+    std::mutex                      mutex_;
+    std::condition_variable         cond_;
+    std::map<std::string, WaitSlot> slots_;
 };
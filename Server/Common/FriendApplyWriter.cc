@@ -0,0 +1,207 @@
+#include "FriendApplyWriter.h"
+#include "ConfigMgr.h"
+#include "Logger.h"
+#include "MysqlMgr.h"
+#include "RedisMgr.h"
+#include "const.h"
+
+#include <chrono>
+
+FriendApplyWriter::FriendApplyWriter() : stopped_(true)
+{
+    auto& cfg   = ConfigMgr::Inst();
+    auto  batch = cfg["WriteBehind"]["BatchSize"];
+    auto  block = cfg["WriteBehind"]["BlockMs"];
+    batch_size_ = batch.empty() ? 128 : stoi(batch);
+    block_ms_   = block.empty() ? 100 : stoi(block);
+}
+
+FriendApplyWriter::~FriendApplyWriter() { Stop(); }
+
+void FriendApplyWriter::Start(const std::string& consumer)
+{
+    if (!stopped_)
+    {
+        return;
+    }
+    consumer_ = consumer;
+    stopped_  = false;
+    thread_   = std::thread(&FriendApplyWriter::Run, this);
+}
+
+void FriendApplyWriter::Stop()
+{
+    stopped_ = true;
+    if (thread_.joinable())
+    {
+        thread_.join();
+    }
+}
+
+bool FriendApplyWriter::Enqueue(int from, int to)
+{
+    if (stopped_)
+    {
+        return false;
+    }
+    auto id = RedisMgr::GetInstance()->XAdd(FRIEND_APPLY_STREAM,
+        {"from", std::to_string(from), "to", std::to_string(to)});
+    return !id.empty();
+}
+
+bool FriendApplyWriter::Connect()
+{
+    auto& cfg = ConfigMgr::Inst();
+    redis_.reset(new Redis(cfg["Redis"]["Host"], stoi(cfg["Redis"]["Port"]),
+        cfg["Redis"]["Passwd"]));
+    if (!redis_->connect())
+    {
+        redis_.reset();
+        return false;
+    }
+
+    // 从0开始建组, 建组前已写入的记录也会被消费, 组已存在时忽略BUSYGROUP
+    // 错误回复同样返回 nullptr, 需要从 getLastError 区分
+    auto reply = redis_->exec("XGROUP", "CREATE", FRIEND_APPLY_STREAM,
+        FRIEND_APPLY_GROUP, "0", "MKSTREAM");
+    if (reply == nullptr &&
+        redis_->getLastError().compare(0, 9, "BUSYGROUP") != 0)
+    {
+        LOG_ERROR("FriendApplyWriter create group failed: {}",
+                  redis_->getLastError());
+        redis_.reset();
+        return false;
+    }
+    return true;
+}
+
+bool FriendApplyWriter::ReadBatch(const std::string& start_id,
+    std::vector<std::string>& ids, std::vector<std::pair<int, int>>& applies)
+{
+    auto reply = redis_->exec("XREADGROUP", "GROUP", FRIEND_APPLY_GROUP,
+        consumer_, "COUNT", batch_size_, "BLOCK", block_ms_, "STREAMS",
+        FRIEND_APPLY_STREAM, start_id);
+    if (reply == nullptr)
+    {
+        // 连接断开或错误回复(如 NOGROUP), 重连后会重新建组
+        LOG_ERROR("FriendApplyWriter XREADGROUP failed: {}",
+                  redis_->getLastError());
+        return false;
+    }
+    // 超时没有新记录
+    if (reply->type != REDIS_REPLY_ARRAY || reply->elements == 0)
+    {
+        return true;
+    }
+
+    // [[stream, [[id, [field, value, ...]], ...]]]
+    auto stream = reply->element[0];
+    if (stream->type != REDIS_REPLY_ARRAY || stream->elements < 2)
+    {
+        return true;
+    }
+    auto entries = stream->element[1];
+    for (size_t i = 0; i < entries->elements; ++i)
+    {
+        auto entry = entries->element[i];
+        if (entry->type != REDIS_REPLY_ARRAY || entry->elements < 2)
+        {
+            continue;
+        }
+        ids.emplace_back(entry->element[0]->str, entry->element[0]->len);
+
+        // 已被删除的记录字段为空, 只需确认
+        auto fields = entry->element[1];
+        if (fields->type != REDIS_REPLY_ARRAY)
+        {
+            continue;
+        }
+        int from = 0;
+        int to   = 0;
+        for (size_t j = 0; j + 1 < fields->elements; j += 2)
+        {
+            std::string key(fields->element[j]->str, fields->element[j]->len);
+            int         value = atoi(fields->element[j + 1]->str);
+            if (key == "from")
+            {
+                from = value;
+            }
+            else if (key == "to")
+            {
+                to = value;
+            }
+        }
+        if (from > 0 && to > 0)
+        {
+            applies.emplace_back(from, to);
+        }
+    }
+    return true;
+}
+
+bool FriendApplyWriter::Ack(const std::vector<std::string>& ids)
+{
+    auto reply =
+        redis_->exec("XACK", FRIEND_APPLY_STREAM, FRIEND_APPLY_GROUP, ids);
+    if (reply == nullptr)
+    {
+        LOG_ERROR("FriendApplyWriter XACK failed: {}", redis_->getLastError());
+        return false;
+    }
+    // 已落库的记录不再需要保留
+    reply = redis_->exec("XDEL", FRIEND_APPLY_STREAM, ids);
+    if (reply == nullptr)
+    {
+        LOG_ERROR("FriendApplyWriter XDEL failed: {}", redis_->getLastError());
+        return false;
+    }
+    return true;
+}
+
+void FriendApplyWriter::Run()
+{
+    // 先重放本消费者已读取但未确认的记录, 读完后再读新记录
+    std::string start_id = "0";
+    while (!stopped_)
+    {
+        if (!redis_ && !Connect())
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(500));
+            continue;
+        }
+
+        std::vector<std::string>         ids;
+        std::vector<std::pair<int, int>> applies;
+        if (!ReadBatch(start_id, ids, applies))
+        {
+            LOG_ERROR("FriendApplyWriter read stream failed");
+            redis_.reset();
+            start_id = "0";
+            continue;
+        }
+
+        if (ids.empty())
+        {
+            start_id = ">";
+            continue;
+        }
+
+        // 写库失败时不确认, 稍后从未确认的记录重新开始
+        if (!MysqlMgr::GetInstance()->AddFriendApplies(applies))
+        {
+            LOG_ERROR("FriendApplyWriter flush failed, count: {}", ids.size());
+            start_id = "0";
+            std::this_thread::sleep_for(std::chrono::seconds(1));
+            continue;
+        }
+
+        if (!Ack(ids))
+        {
+            // 未确认的记录会被重放, 申请写入是幂等的
+            LOG_ERROR("FriendApplyWriter ack failed, count: {}", ids.size());
+            redis_.reset();
+            start_id = "0";
+        }
+    }
+    redis_.reset();
+}
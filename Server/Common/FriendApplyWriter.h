@@ -0,0 +1,45 @@
+#pragma once
+
+#include "Singleton.h"
+#include "redis.h"
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// 好友申请的写后队列
+// 申请写入redis stream即可回复客户端, 后台线程按批读取并一次事务写入mysql,
+// 写库成功后再XACK/XDEL, 进程退出时未确认的记录在下次启动时重放
+class FriendApplyWriter : public Singleton<FriendApplyWriter>
+{
+    friend class Singleton<FriendApplyWriter>;
+
+  public:
+    ~FriendApplyWriter();
+
+    // consumer为消费者名, 使用固定的服务器名才能在重启后接管自己未确认的记录
+    void Start(const std::string& consumer);
+    void Stop();
+
+    // 写入stream成功返回true, 失败时调用方应同步写库
+    bool Enqueue(int from, int to);
+
+  private:
+    FriendApplyWriter();
+
+    void Run();
+    bool Connect();
+    bool ReadBatch(const std::string& start_id, std::vector<std::string>& ids,
+        std::vector<std::pair<int, int>>& applies);
+    bool Ack(const std::vector<std::string>& ids);
+
+    std::string consumer_;
+    int         batch_size_;
+    int         block_ms_;
+
+    std::unique_ptr<Redis> redis_;
+    std::thread            thread_;
+    std::atomic<bool>      stopped_;
+};
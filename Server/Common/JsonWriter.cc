@@ -0,0 +1,217 @@
+#include "JsonWriter.h"
+
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+
+JsonKey::JsonKey(std::string_view name)
+{
+    fragment_.reserve(name.size() + 3);
+    JsonWriter::AppendEscaped(fragment_, name);
+    fragment_ += ':';
+}
+
+JsonWriter::JsonWriter(std::string& out)
+    : out_(out), written_(0), depth_(0), after_key_(false)
+{}
+
+void JsonWriter::separator()
+{
+    if (after_key_)
+    {
+        after_key_ = false;
+        return;
+    }
+    uint64_t bit = 1ULL << (depth_ & 63);
+    if (written_ & bit)
+    {
+        out_ += ',';
+    }
+    written_ |= bit;
+}
+
+JsonWriter& JsonWriter::BeginObject()
+{
+    separator();
+    out_ += '{';
+    ++depth_;
+    written_ &= ~(1ULL << (depth_ & 63));
+    return *this;
+}
+
+JsonWriter& JsonWriter::EndObject()
+{
+    --depth_;
+    out_ += '}';
+    return *this;
+}
+
+JsonWriter& JsonWriter::BeginArray()
+{
+    separator();
+    out_ += '[';
+    ++depth_;
+    written_ &= ~(1ULL << (depth_ & 63));
+    return *this;
+}
+
+JsonWriter& JsonWriter::EndArray()
+{
+    --depth_;
+    out_ += ']';
+    return *this;
+}
+
+JsonWriter& JsonWriter::Key(const JsonKey& key)
+{
+    separator();
+    out_ += key.Fragment();
+    after_key_ = true;
+    return *this;
+}
+
+JsonWriter& JsonWriter::Key(std::string_view key)
+{
+    separator();
+    AppendEscaped(out_, key);
+    out_ += ':';
+    after_key_ = true;
+    return *this;
+}
+
+JsonWriter& JsonWriter::Int(int64_t value)
+{
+    separator();
+    char buf[24];
+    auto res = std::to_chars(buf, buf + sizeof(buf), value);
+    out_.append(buf, res.ptr - buf);
+    return *this;
+}
+
+JsonWriter& JsonWriter::UInt(uint64_t value)
+{
+    separator();
+    char buf[24];
+    auto res = std::to_chars(buf, buf + sizeof(buf), value);
+    out_.append(buf, res.ptr - buf);
+    return *this;
+}
+
+JsonWriter& JsonWriter::Double(double value)
+{
+    if (!std::isfinite(value))
+    {
+        return Null();
+    }
+    separator();
+    char buf[32];
+    int  len = snprintf(buf, sizeof(buf), "%.17g", value);
+    out_.append(buf, len);
+    return *this;
+}
+
+JsonWriter& JsonWriter::Bool(bool value)
+{
+    separator();
+    out_ += value ? "true" : "false";
+    return *this;
+}
+
+JsonWriter& JsonWriter::String(std::string_view value)
+{
+    separator();
+    AppendEscaped(out_, value);
+    return *this;
+}
+
+JsonWriter& JsonWriter::Null()
+{
+    separator();
+    out_ += "null";
+    return *this;
+}
+
+JsonWriter& JsonWriter::Value(const Json::Value& value)
+{
+    switch (value.type())
+    {
+        case Json::nullValue: return Null();
+        case Json::intValue: return Int(value.asInt64());
+        case Json::uintValue: return UInt(value.asUInt64());
+        case Json::realValue: return Double(value.asDouble());
+        case Json::booleanValue: return Bool(value.asBool());
+        case Json::stringValue:
+        {
+            const char* begin = nullptr;
+            const char* end   = nullptr;
+            value.getString(&begin, &end);
+            return String(std::string_view(begin, end - begin));
+        }
+        case Json::arrayValue:
+        {
+            BeginArray();
+            for (Json::ArrayIndex i = 0; i < value.size(); ++i)
+            {
+                Value(value[i]);
+            }
+            return EndArray();
+        }
+        case Json::objectValue:
+        {
+            BeginObject();
+            for (auto it = value.begin(); it != value.end(); ++it)
+            {
+                // memberName 不拷贝字段名
+                const char* end  = nullptr;
+                const char* name = it.memberName(&end);
+                Key(std::string_view(name, end - name));
+                Value(*it);
+            }
+            return EndObject();
+        }
+    }
+    return *this;
+}
+
+std::string JsonWriter::Write(const Json::Value& value)
+{
+    std::string out;
+    JsonWriter(out).Value(value);
+    return out;
+}
+
+void JsonWriter::AppendEscaped(std::string& out, std::string_view value)
+{
+    static const char* digits = "0123456789abcdef";
+
+    out += '"';
+    size_t run = 0;
+    for (size_t i = 0; i < value.size(); ++i)
+    {
+        unsigned char c = value[i];
+        if (c >= 0x20 && c != '"' && c != '\\')
+        {
+            continue;
+        }
+        // 先整段追加不需要转义的部分
+        out.append(value.data() + run, i - run);
+        run = i + 1;
+        switch (c)
+        {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\b': out += "\\b"; break;
+            case '\f': out += "\\f"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                out += "\\u00";
+                out += digits[c >> 4];
+                out += digits[c & 0x0F];
+                break;
+        }
+    }
+    out.append(value.data() + run, value.size() - run);
+    out += '"';
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+#include <jsoncpp/json/value.h>
+#include <string>
+#include <string_view>
+
+// 预先拼好的字段名片段, 形如 "name":, 写入时直接追加
+// 一般定义为静态常量, 避免每次转义字段名
+class JsonKey
+{
+  public:
+    explicit JsonKey(std::string_view name);
+
+    const std::string& Fragment() const { return fragment_; }
+
+  private:
+    std::string fragment_;
+};
+
+// 紧凑格式的流式 JSON 写入器, 直接追加到调用方的缓冲区, 不构建 DOM
+// 逗号由写入器按层级自动补齐, 嵌套深度不超过 64
+class JsonWriter
+{
+  public:
+    explicit JsonWriter(std::string& out);
+
+    JsonWriter& BeginObject();
+    JsonWriter& EndObject();
+    JsonWriter& BeginArray();
+    JsonWriter& EndArray();
+
+    JsonWriter& Key(const JsonKey& key);
+    JsonWriter& Key(std::string_view key);
+
+    JsonWriter& Int(int64_t value);
+    JsonWriter& UInt(uint64_t value);
+    JsonWriter& Double(double value);
+    JsonWriter& Bool(bool value);
+    JsonWriter& String(std::string_view value);
+    JsonWriter& Null();
+    // 兼容已有的 Json::Value, 按紧凑格式写出
+    JsonWriter& Value(const Json::Value& value);
+
+    JsonWriter& Field(const JsonKey& key, int value)
+    {
+        return Key(key).Int(value);
+    }
+    JsonWriter& Field(const JsonKey& key, int64_t value)
+    {
+        return Key(key).Int(value);
+    }
+    JsonWriter& Field(const JsonKey& key, bool value)
+    {
+        return Key(key).Bool(value);
+    }
+    JsonWriter& Field(const JsonKey& key, std::string_view value)
+    {
+        return Key(key).String(value);
+    }
+    JsonWriter& Field(const JsonKey& key, const char* value)
+    {
+        return Key(key).String(value);
+    }
+    JsonWriter& Field(const JsonKey& key, const std::string& value)
+    {
+        return Key(key).String(value);
+    }
+
+    // 替代 toStyledString, 输出不带缩进与换行
+    static std::string Write(const Json::Value& value);
+
+    static void AppendEscaped(std::string& out, std::string_view value);
+
+  private:
+    // 写值之前补逗号
+    void separator();
+
+    std::string& out_;
+    // 每一层是否已经写过元素
+    uint64_t written_;
+    int      depth_;
+    bool     after_key_;
+};
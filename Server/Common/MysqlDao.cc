@@ -2,86 +2,250 @@
 #include "ConfigMgr.h"
 #include "Logger.h"
 
-MysqlDao::MysqlDao()
+#include <mysql/mysqld_error.h>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <set>
+#include <sstream>
+
+// user表的列顺序: uid, name, email, pwd, nick, `desc`, sex, icon
+template <>
+struct MySQLRowMapper<UserInfo>
 {
-    auto&       cfg    = ConfigMgr::Inst();
-    const auto& host   = cfg["Mysql"]["Host"];
-    const auto& port   = cfg["Mysql"]["Port"];
-    const auto& pwd    = cfg["Mysql"]["Passwd"];
-    const auto& schema = cfg["Mysql"]["Schema"];
-    const auto& user   = cfg["Mysql"]["User"];
-    pool_.reset(new MySQLPool(host, stoi(port), user, pwd, schema, 5, 5));
-}
+    static auto fields()
+    {
+        return std::make_tuple(&UserInfo::uid_, &UserInfo::name_,
+            &UserInfo::email_, &UserInfo::pwd_, &UserInfo::nick_,
+            &UserInfo::desc_, &UserInfo::sex_, &UserInfo::icon_);
+    }
+};
 
-MysqlDao::~MysqlDao() {}
+// 好友列表的列顺序: friend_id, back, name, email, nick, sex, icon
+struct FriendRowMapper
+{
+    static auto fields()
+    {
+        return std::make_tuple(&UserInfo::uid_, &UserInfo::back_,
+            &UserInfo::name_, &UserInfo::email_, &UserInfo::nick_,
+            &UserInfo::sex_, &UserInfo::icon_);
+    }
+};
 
-int MysqlDao::RegUser(const std::string& name, const std::string& email,
-    const std::string& pwd, const std::string& icon)
+// 按配置段创建连接池, 从库未配置的账号信息沿用主库
+static MySQLPool* createPool(SectionInfo section, SectionInfo primary)
 {
-    auto con = pool_->get();
-    if (con == nullptr)
+    auto get = [&](const std::string& key) {
+        auto value = section[key];
+        return value.empty() ? primary[key] : value;
+    };
+    const auto& host         = get("Host");
+    const auto& port         = get("Port");
+    const auto& pwd          = get("Passwd");
+    const auto& schema       = get("Schema");
+    const auto& user         = get("User");
+    const auto& min_conn     = get("MinConn");
+    const auto& max_conn     = get("MaxConn");
+    const auto& wait_timeout = get("WaitTimeout");
+    const auto& stmt_cache   = get("StmtCacheSize");
+
+    auto pool = new MySQLPool(host, stoi(port), user, pwd, schema,
+        max_conn.empty() ? 5 : stoi(max_conn), 5);
+    pool->setMinConn(min_conn.empty() ? 2 : stoul(min_conn));
+    pool->setWaitTimeout(wait_timeout.empty() ? 1000 : stoul(wait_timeout));
+    if (!stmt_cache.empty())
     {
-        LOG_ERROR("Failed to get connection from pool");
-        return -1;
+        pool->setStmtCacheSize(stoul(stmt_cache));
     }
+    pool->start();
+    return pool;
+}
 
-    try
+MysqlDao::MysqlDao() : total_weight_(0), uid_next_(0), uid_end_(0)
+{
+    auto& cfg = ConfigMgr::Inst();
+    pool_.reset(createPool(cfg["Mysql"], cfg["Mysql"]));
+
+    // 每次从user_id表预留的uid数量
+    auto uid_block = cfg["Mysql"]["UidBlockSize"];
+    uid_block_     = uid_block.empty() ? 1000 : stoi(uid_block);
+
+    // 从库列表, 例如 Replicas = replica1,replica2, 每个从库单独一个配置段
+    std::stringstream ss(cfg["Mysql"]["Replicas"]);
+    std::string       name;
+    while (std::getline(ss, name, ','))
     {
-        // 开始事务
-        MySQLTransaction::ptr tran = std::static_pointer_cast<MySQLTransaction>(
-            con->openTransaction(false));
-        if (!tran->begin())
+        if (name.empty() || cfg[name]["Host"].empty())
         {
-            std::cerr << "Failed to begin transaction" << std::endl;
-            return -1;
+            continue;
         }
-
-        // 检查 email 是否已存在
-        auto emailCheck = tran->getMySQL()->queryStmt(
-            "SELECT 1 FROM user WHERE email = ?", email.c_str());
-
-        if (emailCheck && emailCheck->next())
+        auto weight_str = cfg[name]["Weight"];
+        int  weight     = weight_str.empty() ? 1 : stoi(weight_str);
+        if (weight <= 0)
         {
-            tran->rollback();
-            std::cerr << "Email " << email << " already exists" << std::endl;
-            return 0;
+            continue;
         }
 
-        // 检查 name 是否已存在
-        auto nameCheck = tran->getMySQL()->queryStmt(
-            "SELECT 1 FROM user WHERE name = ?", name.c_str());
-        if (nameCheck && nameCheck->next())
+        auto replica        = std::make_unique<Replica>();
+        replica->name       = name;
+        replica->weight     = weight;
+        replica->down_until = 0;
+        replica->pool.reset(createPool(cfg[name], cfg["Mysql"]));
+        total_weight_ += weight;
+        replicas_.push_back(std::move(replica));
+        LOG_INFO("mysql replica: {}, weight: {}", name, weight);
+    }
+}
+
+MysqlDao::~MysqlDao()
+{
+    for (auto& replica : replicas_)
+    {
+        replica->pool->stop();
+    }
+    pool_->stop();
+}
+
+MySQL::ptr MysqlDao::getReadConn(bool primary)
+{
+    if (primary || replicas_.empty())
+    {
+        return pool_->get();
+    }
+
+    auto now = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch())
+                   .count();
+
+    // 按权重随机选出起点, 不可用时依次尝试后面的从库
+    thread_local std::mt19937          rng(std::random_device{}());
+    std::uniform_int_distribution<int> dist(0, total_weight_ - 1);
+    int                                r     = dist(rng);
+    size_t                             start = 0;
+    while (r >= replicas_[start]->weight)
+    {
+        r -= replicas_[start]->weight;
+        start++;
+    }
+
+    for (size_t i = 0; i < replicas_.size(); ++i)
+    {
+        auto& replica = replicas_[(start + i) % replicas_.size()];
+        if (replica->down_until > now)
         {
-            tran->rollback();
-            std::cerr << "Name " << name << " already exists" << std::endl;
-            return 0;
+            continue;
         }
-
-        // 更新 user_id 表
-        if (tran->execute("UPDATE user_id SET id = id + 1") != 0)
+        bool timeout = false;
+        auto con     = replica->pool->get(&timeout);
+        if (con)
         {
-            tran->rollback();
-            std::cerr << "Failed to update user_id" << std::endl;
-            return -1;
+            return con;
         }
-
-        // 获取新的用户 ID
-        auto userIdResult =
-            tran->getMySQL()->queryStmt("SELECT id FROM user_id");
-        int newId = 0;
-        if (userIdResult && userIdResult->next())
+        // 连接池繁忙只换下一个从库, 连不上的从库才暂时摘除
+        // 查询中断开的连接会在下次借出时重连失败, 同样走到这里
+        if (timeout)
         {
-            newId = userIdResult->getInt32(0);
+            continue;
         }
-        else
+        replica->down_until = now + 5000;
+        LOG_ERROR("mysql replica unavailable: {}", replica->name);
+    }
+
+    // 从库都不可用时回退到主库
+    return pool_->get();
+}
+
+// 在事务中为uid追加一条变更记录
+// friend_version行锁保证同一用户的版本号严格递增且按提交顺序可见
+// 同一事务涉及多个uid时按uid从小到大调用, 保证加锁顺序一致
+static bool appendFriendChange(MySQL::ptr con, const int uid,
+    const int peer_uid, const int op, const int status)
+{
+    int ret = con->execStmt("INSERT INTO friend_version (uid, version) "
+                            "VALUES (?, 1) "
+                            "ON DUPLICATE KEY UPDATE version = version + 1",
+        (int32_t)uid);
+    if (ret != 0)
+    {
+        return false;
+    }
+
+    ret = con->execStmt(
+        "INSERT INTO friend_change (uid, version, peer_uid, op, status) "
+        "SELECT uid, version, ?, ?, ? FROM friend_version WHERE uid = ?",
+        (int32_t)peer_uid, (int32_t)op, (int32_t)status, (int32_t)uid);
+    return ret == 0;
+}
+
+// 申请写入后为被申请方记录一条收到申请的变更
+// 重放或迟到的申请不会改变已通过的状态, 此时不再记录, 避免增量同步回退为待处理
+static bool appendApplyChange(MySQL::ptr con, const int from, const int to)
+{
+    auto result = con->queryStmt("SELECT status FROM friend_apply "
+                                 "WHERE from_uid = ? AND to_uid = ?",
+        (int32_t)from, (int32_t)to);
+    if (result == nullptr || !result->next())
+    {
+        return false;
+    }
+
+    int status = result->getInt16(0);
+    if (status == 1)
+    {
+        return true;
+    }
+    return appendFriendChange(con, to, from, FRIEND_CHANGE_APPLY, status);
+}
+
+int MysqlDao::allocUid(MySQL::ptr con)
+{
+    std::lock_guard<std::mutex> lock(uid_mutex_);
+    if (uid_next_ > 0 && uid_next_ <= uid_end_)
+    {
+        return uid_next_++;
+    }
+
+    // 一次预留一段uid, 行锁只在这条自动提交的语句内持有
+    if (con->execStmt("UPDATE user_id SET id = LAST_INSERT_ID(id + ?)",
+            (int32_t)uid_block_) != 0)
+    {
+        LOG_ERROR("Failed to reserve uid block, errno: {}", con->getErrno());
+        return -1;
+    }
+
+    auto result = con->queryStmt("SELECT LAST_INSERT_ID()");
+    if (result == nullptr || !result->next())
+    {
+        LOG_ERROR("Failed to retrieve reserved uid block");
+        return -1;
+    }
+
+    uid_end_  = (int)result->getInt64(0);
+    uid_next_ = uid_end_ - uid_block_ + 1;
+    LOG_INFO("Reserved uid block [{}, {}]", uid_next_, uid_end_);
+    return uid_next_++;
+}
+
+int MysqlDao::RegUser(const std::string& name, const std::string& email,
+    const std::string& pwd, const std::string& icon)
+{
+    auto con = pool_->get();
+    if (con == nullptr)
+    {
+        LOG_ERROR("Failed to get connection from pool");
+        return -1;
+    }
+
+    try
+    {
+        int newId = allocUid(con);
+        if (newId <= 0)
         {
-            tran->rollback();
-            std::cerr << "Failed to retrieve new user ID" << std::endl;
             return -1;
         }
 
-        // 插入新用户
-        if (tran->getMySQL()->execStmt(
+        // name和email都有唯一索引, 重复时插入直接失败, 无需事先查询
+        if (con->execStmt(
                 "INSERT INTO user (uid, name, email, pwd, nick, icon) VALUES "
                 "(?, ?, ?, ?, ?, ?)",
                 newId,
@@ -91,18 +255,16 @@ int MysqlDao::RegUser(const std::string& name, const std::string& email,
                 name.c_str(),
                 icon.c_str()) != 0)
         {
-            tran->rollback();
+            if (con->getErrno() == ER_DUP_ENTRY)
+            {
+                std::cerr << "Name " << name << " or email " << email
+                          << " already exists" << std::endl;
+                return 0;
+            }
             std::cerr << "Failed to insert new user" << std::endl;
             return -1;
         }
 
-        // 提交事务
-        if (!tran->commit())
-        {
-            std::cerr << "Failed to commit transaction" << std::endl;
-            return -1;
-        }
-
         std::cout << "User registered successfully with ID: " << newId
                   << std::endl;
         return newId;
@@ -114,9 +276,10 @@ int MysqlDao::RegUser(const std::string& name, const std::string& email,
     }
 }
 
-bool MysqlDao::CheckEmail(const std::string& name, const std::string& email)
+bool MysqlDao::CheckEmail(
+    const std::string& name, const std::string& email, bool primary)
 {
-    auto con = pool_->get();
+    auto con = getReadConn(primary);
     if (con == nullptr)
     {
         LOG_ERROR("Failed to get connection from pool");
@@ -173,10 +336,10 @@ bool MysqlDao::UpdatePwd(const std::string& name, const std::string& newpwd)
     }
 }
 
-bool MysqlDao::CheckPwd(
-    const std::string& email, const std::string& pwd, UserInfo& userInfo)
+bool MysqlDao::CheckPwd(const std::string& email, const std::string& pwd,
+    UserInfo& userInfo, bool primary)
 {
-    auto con = pool_->get();
+    auto con = getReadConn(primary);
     if (con == nullptr)
     {
         LOG_ERROR("Failed to get connection from pool");
@@ -224,27 +387,46 @@ bool MysqlDao::AddFriendApply(const int from, const int to)
 
     try
     {
-        int ret = con->execStmt(
+        MySQLTransaction::ptr tran = std::static_pointer_cast<MySQLTransaction>(
+            con->openTransaction(false));
+        if (!tran->begin())
+        {
+            LOG_ERROR("Failed to begin transaction");
+            return false;
+        }
+
+        int ret = tran->getMySQL()->execStmt(
             "INSERT INTO friend_apply (from_uid, to_uid) VALUES (?, ?) "
             "ON DUPLICATE KEY UPDATE from_uid = VALUES(from_uid), to_uid = "
             "VALUES(to_uid)",
             (int32_t)from,
             (int32_t)to);
-
-        if (ret == 0)
-        {
-            LOG_DEBUG("Friend apply added or updated successfully, fromuid: "
-                      "{}, touid: {}",
-                      from, to);
-            return true;
-        }
-        else
+        if (ret != 0)
         {
+            tran->rollback();
             LOG_ERROR(
                 "No rows affected for friend apply, fromuid: {}, touid: {} ",
                 from, to);
             return false;
         }
+
+        if (!appendApplyChange(tran->getMySQL(), from, to))
+        {
+            tran->rollback();
+            LOG_ERROR("Failed to append friend change for user: {}", to);
+            return false;
+        }
+
+        if (!tran->commit())
+        {
+            LOG_ERROR("Failed to commit transaction");
+            return false;
+        }
+
+        LOG_DEBUG("Friend apply added or updated successfully, fromuid: "
+                  "{}, touid: {}",
+                  from, to);
+        return true;
     }
     catch (const std::exception& e)
     {
@@ -253,6 +435,112 @@ bool MysqlDao::AddFriendApply(const int from, const int to)
     }
 }
 
+bool MysqlDao::AddFriendApplies(
+    const std::vector<std::pair<int, int>>& applies)
+{
+    if (applies.empty())
+    {
+        return true;
+    }
+
+    auto con = pool_->get();
+    if (con == nullptr)
+    {
+        LOG_ERROR("Failed to get connection from pool");
+        return false;
+    }
+
+    // 同一批中重复的申请只写一次
+    std::vector<std::pair<int, int>> rows;
+    std::set<std::pair<int, int>>    seen;
+    for (auto& apply : applies)
+    {
+        if (seen.insert(apply).second)
+        {
+            rows.push_back(apply);
+        }
+    }
+    // 按被申请方uid排序, friend_version行锁与其他事务一样从小到大获取
+    std::sort(rows.begin(), rows.end(),
+        [](const std::pair<int, int>& a, const std::pair<int, int>& b) {
+            return std::make_pair(a.second, a.first) <
+                   std::make_pair(b.second, b.first);
+        });
+
+    try
+    {
+        // 整批在一个事务中提交
+        MySQLTransaction::ptr tran = std::static_pointer_cast<MySQLTransaction>(
+            con->openTransaction(false));
+        if (!tran->begin())
+        {
+            LOG_ERROR("Failed to begin transaction");
+            return false;
+        }
+
+        // 行数补齐到2的幂, 多出的行重复最后一条, 由ON DUPLICATE KEY吸收
+        size_t slots = 1;
+        while (slots < rows.size())
+        {
+            slots <<= 1;
+        }
+        std::string sql = "INSERT INTO friend_apply (from_uid, to_uid) VALUES "
+                          "(?, ?)";
+        for (size_t i = 1; i < slots; ++i)
+        {
+            sql += ", (?, ?)";
+        }
+        sql += " ON DUPLICATE KEY UPDATE from_uid = VALUES(from_uid), to_uid "
+               "= VALUES(to_uid)";
+
+        auto st = MySQLStmt::Create(tran->getMySQL(), sql);
+        if (!st)
+        {
+            tran->rollback();
+            LOG_ERROR("Failed to prepare AddFriendApplies");
+            return false;
+        }
+        for (size_t i = 0; i < slots; ++i)
+        {
+            auto& row = rows[std::min(i, rows.size() - 1)];
+            st->bindInt32(i * 2 + 1, row.first);
+            st->bindInt32(i * 2 + 2, row.second);
+        }
+        if (st->execute() != 0)
+        {
+            tran->rollback();
+            LOG_ERROR("Failed to insert friend applies, errno: {}",
+                st->getErrno());
+            return false;
+        }
+
+        for (auto& row : rows)
+        {
+            if (!appendApplyChange(tran->getMySQL(), row.first, row.second))
+            {
+                tran->rollback();
+                LOG_ERROR("Failed to append friend change for user: {}",
+                    row.second);
+                return false;
+            }
+        }
+
+        if (!tran->commit())
+        {
+            LOG_ERROR("Failed to commit transaction");
+            return false;
+        }
+
+        LOG_DEBUG("Friend applies added, count: {}", rows.size());
+        return true;
+    }
+    catch (const std::exception& e)
+    {
+        LOG_ERROR("Exception in AddFriendApplies: {}", e.what());
+        return false;
+    }
+}
+
 bool MysqlDao::AuthFriendApply(const int from, const int to)
 {
     auto con = pool_->get();
@@ -264,26 +552,49 @@ bool MysqlDao::AuthFriendApply(const int from, const int to)
 
     try
     {
+        MySQLTransaction::ptr tran = std::static_pointer_cast<MySQLTransaction>(
+            con->openTransaction(false));
+        if (!tran->begin())
+        {
+            LOG_ERROR("Failed to begin transaction");
+            return false;
+        }
+
         // 反过来的申请时from，验证时to
-        int ret = con->execStmt("UPDATE friend_apply SET status = 1 "
-                                "WHERE from_uid = ? AND to_uid = ?",
+        // 申请可能还在写后队列中未落库, 用upsert保证先后顺序不影响结果
+        int ret = tran->getMySQL()->execStmt(
+            "INSERT INTO friend_apply (from_uid, to_uid, status) "
+            "VALUES (?, ?, 1) ON DUPLICATE KEY UPDATE status = 1",
             (int32_t)to,
             (int32_t)from);
-
-        if (ret == 0)
-        {
-            LOG_DEBUG("Friend apply authenticated successfully, fromuid: {}, "
-                      "touid: {}",
-                      from, to);
-            return true;
-        }
-        else
+        if (ret != 0)
         {
+            tran->rollback();
             LOG_ERROR("No rows affected for friend apply authentication, "
                       "fromuid: {}, touid: {}",
                       from, to);
             return false;
         }
+
+        // 申请列表属于认证方, 记录申请状态变更
+        if (!appendFriendChange(
+                tran->getMySQL(), from, to, FRIEND_CHANGE_APPLY_AUTH, 1))
+        {
+            tran->rollback();
+            LOG_ERROR("Failed to append friend change for user: {}", from);
+            return false;
+        }
+
+        if (!tran->commit())
+        {
+            LOG_ERROR("Failed to commit transaction");
+            return false;
+        }
+
+        LOG_DEBUG("Friend apply authenticated successfully, fromuid: {}, "
+                  "touid: {}",
+                  from, to);
+        return true;
     }
     catch (const std::exception& e)
     {
@@ -340,6 +651,21 @@ bool MysqlDao::AddFriend(
             return false;
         }
 
+        // 双方各记录一条新增好友变更
+        // 按uid从小到大加friend_version行锁, 避免互加好友时交叉等待死锁
+        int first  = std::min(from, to);
+        int second = std::max(from, to);
+        if (!appendFriendChange(
+                tran->getMySQL(), first, second, FRIEND_CHANGE_ADD, 0) ||
+            !appendFriendChange(
+                tran->getMySQL(), second, first, FRIEND_CHANGE_ADD, 0))
+        {
+            tran->rollback();
+            LOG_ERROR("Failed to append friend change, fromuid: {}, touid: {}",
+                from, to);
+            return false;
+        }
+
         // 提交事务
         if (!tran->commit())
         {
@@ -359,9 +685,9 @@ bool MysqlDao::AddFriend(
     }
 }
 
-std::shared_ptr<UserInfo> MysqlDao::GetUser(const int uid)
+std::shared_ptr<UserInfo> MysqlDao::GetUser(const int uid, bool primary)
 {
-    auto con = pool_->get();
+    auto con = getReadConn(primary);
     if (con == nullptr)
     {
         LOG_ERROR("Failed to get connection from pool");
@@ -371,24 +697,15 @@ std::shared_ptr<UserInfo> MysqlDao::GetUser(const int uid)
     try
     {
         // desc为 mysql 关键字
-        auto result =
-            con->queryStmt("SELECT uid, name, email, pwd, nick, `desc`, sex, "
-                           "icon FROM user WHERE uid = ?",
-                (int32_t)uid);
-        if (result && result->next())
-        {
-            auto user_ptr    = std::make_shared<UserInfo>();
-            user_ptr->uid_   = uid;
-            user_ptr->name_  = result->getString(1);
-            user_ptr->email_ = result->getString(2);
-            user_ptr->pwd_   = result->getString(3);
-            user_ptr->nick_  = result->getString(4);
-            user_ptr->desc_  = result->getString(5);
-            user_ptr->sex_   = result->getInt32(6);
-            user_ptr->icon_  = result->getString(7);
-            return user_ptr;
-        }
-        return nullptr;
+        std::shared_ptr<UserInfo> user_ptr = nullptr;
+        con->foreachAs<UserInfo>(
+            [&user_ptr](UserInfo& row) {
+                user_ptr = std::make_shared<UserInfo>(std::move(row));
+            },
+            "SELECT uid, name, email, pwd, nick, `desc`, sex, icon FROM user "
+            "WHERE uid = ?",
+            (int32_t)uid);
+        return user_ptr;
     }
     catch (const std::exception& e)
     {
@@ -397,36 +714,98 @@ std::shared_ptr<UserInfo> MysqlDao::GetUser(const int uid)
     }
 }
 
-std::shared_ptr<UserInfo> MysqlDao::GetUser(const std::string& name)
+bool MysqlDao::GetUsers(const std::vector<int>& uids,
+    std::vector<std::shared_ptr<UserInfo>>& users, bool primary)
 {
-    auto con = pool_->get();
+    if (uids.empty())
+    {
+        return true;
+    }
+
+    auto con = getReadConn(primary);
     if (con == nullptr)
     {
         LOG_ERROR("Failed to get connection from pool");
-        return nullptr;
+        return false;
     }
 
+    // 单条语句最多携带的uid数
+    static const size_t kMaxBatch = 256;
+
     try
     {
-        auto result =
-            con->queryStmt("SELECT uid, name, email, pwd, nick, `desc`, sex, "
-                           "icon FROM user WHERE name = ?",
-                name.c_str());
-        if (result && result->next())
+        for (size_t begin = 0; begin < uids.size(); begin += kMaxBatch)
         {
-            auto user_ptr    = std::make_shared<UserInfo>();
-            user_ptr->uid_   = result->getInt32(0);
-            user_ptr->name_  = name;
-            user_ptr->email_ = result->getString(2);
-            user_ptr->pwd_   = result->getString(3);
-            user_ptr->nick_  = result->getString(4);
-            user_ptr->desc_  = result->getString(5);
-            user_ptr->sex_   = result->getInt32(6);
-            user_ptr->icon_  = result->getString(7);
-            return user_ptr;
+            size_t count = std::min(kMaxBatch, uids.size() - begin);
+            // IN列表长度补齐到2的幂, 预处理语句缓存中最多只有log2(kMaxBatch)种
+            size_t slots = 1;
+            while (slots < count)
+            {
+                slots <<= 1;
+            }
+
+            std::string sql = "SELECT uid, name, email, pwd, nick, `desc`, "
+                              "sex, icon FROM user WHERE uid IN (?";
+            for (size_t i = 1; i < slots; ++i)
+            {
+                sql += ",?";
+            }
+            sql += ")";
+
+            auto st = MySQLStmt::Create(con, sql);
+            if (!st)
+            {
+                LOG_ERROR(
+                    "Failed to prepare GetUsers, errno: {}", con->getErrno());
+                return false;
+            }
+            // 多出的占位用最后一个uid填充, IN去重不影响结果
+            for (size_t i = 0; i < slots; ++i)
+            {
+                st->bindInt32(i + 1, uids[begin + std::min(i, count - 1)]);
+            }
+
+            bool ok = st->fetchAs<UserInfo>([&users](UserInfo& row) {
+                users.push_back(std::make_shared<UserInfo>(std::move(row)));
+            });
+            if (!ok)
+            {
+                LOG_ERROR(
+                    "Failed to fetch GetUsers, errno: {}", st->getErrno());
+                return false;
+            }
         }
+        return true;
+    }
+    catch (const std::exception& e)
+    {
+        LOG_ERROR("Exception in GetUsers: {}", e.what());
+        return false;
+    }
+}
+
+std::shared_ptr<UserInfo> MysqlDao::GetUser(
+    const std::string& name, bool primary)
+{
+    auto con = getReadConn(primary);
+    if (con == nullptr)
+    {
+        LOG_ERROR("Failed to get connection from pool");
         return nullptr;
     }
+
+    try
+    {
+        std::shared_ptr<UserInfo> user_ptr = nullptr;
+        con->foreachAs<UserInfo>(
+            [&user_ptr](UserInfo& row) {
+                user_ptr = std::make_shared<UserInfo>(std::move(row));
+            },
+            "SELECT uid, name, email, pwd, nick, `desc`, sex, icon FROM user "
+            "WHERE name = ?",
+            name.c_str());
+        return user_ptr;
+    }
     catch (const std::exception& e)
     {
         LOG_ERROR("Exception in GetUser: {}", e.what());
@@ -435,9 +814,10 @@ std::shared_ptr<UserInfo> MysqlDao::GetUser(const std::string& name)
 }
 
 bool MysqlDao::GetApplyList(const int        touid,
-    std::vector<std::shared_ptr<ApplyInfo>>& applyList, int begin, int limit)
+    std::vector<std::shared_ptr<ApplyInfo>>& applyList, int begin, int limit,
+    bool primary)
 {
-    auto con = pool_->get();
+    auto con = getReadConn(primary);
     if (con == nullptr)
     {
         LOG_ERROR("Failed to get connection from pool");
@@ -479,10 +859,44 @@ bool MysqlDao::GetApplyList(const int        touid,
     }
 }
 
-bool MysqlDao::GetFriendList(
-    const int self_id, std::vector<std::shared_ptr<UserInfo>>& user_info_list)
+bool MysqlDao::GetFriendList(const int          self_id,
+    std::vector<std::shared_ptr<UserInfo>>& user_info_list, bool primary)
 {
-    auto con = pool_->get();
+    auto con = getReadConn(primary);
+    if (con == nullptr)
+    {
+        LOG_ERROR("Failed to get connection from pool");
+        return false;
+    }
+
+    try
+    {
+        // 结果列直接写入UserInfo
+        return con->foreachAs<UserInfo, FriendRowMapper>(
+            [&user_info_list](UserInfo& row) {
+                user_info_list.push_back(
+                    std::make_shared<UserInfo>(std::move(row)));
+            },
+            "SELECT friend.friend_id, friend.back, user.name, user.email, "
+            "user.nick, user.sex, user.icon "
+            "FROM friend "
+            "JOIN user ON friend.friend_id = user.uid "
+            "WHERE friend.self_id = ?",
+            (int32_t)self_id);
+    }
+    catch (const std::exception& e)
+    {
+        LOG_ERROR("Exception in GetFriendList: {}", e.what());
+        return false;
+    }
+}
+
+bool MysqlDao::GetFriendPage(const int self_id, const int after_id,
+    const int limit, std::vector<std::shared_ptr<UserInfo>>& user_info_list,
+    int& next_id, bool primary)
+{
+    next_id  = 0;
+    auto con = getReadConn(primary);
     if (con == nullptr)
     {
         LOG_ERROR("Failed to get connection from pool");
@@ -491,26 +905,34 @@ bool MysqlDao::GetFriendList(
 
     try
     {
-        // 使用 queryStmt 查询好友列表
+        // 以friend.id为游标分页, 多取一条用于判断是否还有下一页
         auto result =
-            con->queryStmt("SELECT friend.friend_id, friend.back, user.name, "
-                           "user.email, user.nick, user.sex, user.icon "
+            con->queryStmt("SELECT friend.id, friend.friend_id, friend.back, "
+                           "user.name, user.email, user.nick, user.sex, "
+                           "user.icon "
                            "FROM friend "
                            "JOIN user ON friend.friend_id = user.uid "
-                           "WHERE friend.self_id = ?",
-                (int32_t)self_id);
+                           "WHERE friend.self_id = ? AND friend.id > ? "
+                           "ORDER BY friend.id LIMIT ?",
+                (int32_t)self_id, (int32_t)after_id, (int32_t)(limit + 1));
 
-        // 遍历结果集
+        int last_id = 0;
         while (result && result->next())
         {
+            if ((int)user_info_list.size() >= limit)
+            {
+                next_id = last_id;
+                break;
+            }
             auto user_ptr    = std::make_shared<UserInfo>();
-            user_ptr->uid_   = result->getInt32(0);
-            user_ptr->name_  = result->getString(2);
-            user_ptr->email_ = result->getString(3);
-            user_ptr->nick_  = result->getString(4);
-            user_ptr->sex_   = result->getInt32(5);
-            user_ptr->icon_  = result->getString(6);
-            user_ptr->back_  = result->getString(1);
+            last_id          = (int)result->getUint32(0);
+            user_ptr->uid_   = result->getInt32(1);
+            user_ptr->back_  = result->getString(2);
+            user_ptr->name_  = result->getString(3);
+            user_ptr->email_ = result->getString(4);
+            user_ptr->nick_  = result->getString(5);
+            user_ptr->sex_   = result->getInt32(6);
+            user_ptr->icon_  = result->getString(7);
 
             user_info_list.push_back(user_ptr);
         }
@@ -518,7 +940,137 @@ bool MysqlDao::GetFriendList(
     }
     catch (const std::exception& e)
     {
-        LOG_ERROR("Exception in GetFriendList: {}", e.what());
+        LOG_ERROR("Exception in GetFriendPage: {}", e.what());
+        return false;
+    }
+}
+
+bool MysqlDao::GetFriendVersion(
+    const int self_id, int& total, std::string& etag, bool primary)
+{
+    auto con = getReadConn(primary);
+    if (con == nullptr)
+    {
+        LOG_ERROR("Failed to get connection from pool");
+        return false;
+    }
+
+    try
+    {
+        // 列表页里带有好友的资料, 版本由三部分组成:
+        // 数量与最大id标识好友集合, friend_version标识好友关系的变更,
+        // 好友资料的最近更新时间标识昵称、头像等的修改
+        auto result = con->queryStmt(
+            "SELECT CAST(COUNT(*) AS SIGNED), "
+            "CAST(COALESCE(MAX(f.id), 0) AS SIGNED), "
+            "CAST(COALESCE((SELECT version FROM friend_version "
+            "WHERE uid = ?), 0) AS SIGNED), "
+            "CAST(COALESCE(UNIX_TIMESTAMP(MAX(u.update_time)) * 1000, 0) "
+            "AS SIGNED) "
+            "FROM friend f LEFT JOIN user u ON u.uid = f.friend_id "
+            "WHERE f.self_id = ?",
+            (int32_t)self_id, (int32_t)self_id);
+        if (result == nullptr || !result->next())
+        {
+            return false;
+        }
+
+        total = (int)result->getInt64(0);
+        etag  = std::to_string(total) + "-" +
+               std::to_string(result->getInt64(1)) + "-" +
+               std::to_string(result->getInt64(2)) + "-" +
+               std::to_string(result->getInt64(3));
+        return true;
+    }
+    catch (const std::exception& e)
+    {
+        LOG_ERROR("Exception in GetFriendVersion: {}", e.what());
+        return false;
+    }
+}
+
+bool MysqlDao::GetFriendChanges(const int uid, const int64_t since_version,
+    const int limit, std::vector<FriendChange>& changes, bool& more,
+    bool primary)
+{
+    more     = false;
+    auto con = getReadConn(primary);
+    if (con == nullptr)
+    {
+        LOG_ERROR("Failed to get connection from pool");
+        return false;
+    }
+
+    try
+    {
+        auto result = con->queryStmt(
+            "SELECT c.version, c.op, c.status, c.peer_uid, u.name, u.email, "
+            "u.nick, u.sex, u.icon, u.desc, f.back "
+            "FROM friend_change c "
+            "JOIN user u ON c.peer_uid = u.uid "
+            "LEFT JOIN friend f ON f.self_id = c.uid AND f.friend_id = "
+            "c.peer_uid "
+            "WHERE c.uid = ? AND c.version > ? "
+            "ORDER BY c.version LIMIT ?",
+            (int32_t)uid, (int64_t)since_version, (int32_t)(limit + 1));
+
+        while (result && result->next())
+        {
+            if ((int)changes.size() >= limit)
+            {
+                more = true;
+                break;
+            }
+            FriendChange change;
+            change.version_     = result->getInt64(0);
+            change.op_          = result->getInt16(1);
+            change.status_      = result->getInt16(2);
+            change.peer_.uid_   = result->getInt32(3);
+            change.peer_.name_  = result->getString(4);
+            change.peer_.email_ = result->getString(5);
+            change.peer_.nick_  = result->getString(6);
+            change.peer_.sex_   = result->getInt32(7);
+            change.peer_.icon_  = result->getString(8);
+            change.peer_.desc_  = result->getString(9);
+            if (!result->isNull(10))
+            {
+                change.peer_.back_ = result->getString(10);
+            }
+            changes.push_back(std::move(change));
+        }
+        return true;
+    }
+    catch (const std::exception& e)
+    {
+        LOG_ERROR("Exception in GetFriendChanges: {}", e.what());
+        return false;
+    }
+}
+
+bool MysqlDao::GetFriendSyncVersion(
+    const int uid, int64_t& version, bool primary)
+{
+    version  = 0;
+    auto con = getReadConn(primary);
+    if (con == nullptr)
+    {
+        LOG_ERROR("Failed to get connection from pool");
+        return false;
+    }
+
+    try
+    {
+        auto result = con->queryStmt(
+            "SELECT version FROM friend_version WHERE uid = ?", (int32_t)uid);
+        if (result && result->next())
+        {
+            version = result->getInt64(0);
+        }
+        return true;
+    }
+    catch (const std::exception& e)
+    {
+        LOG_ERROR("Exception in GetFriendSyncVersion: {}", e.what());
         return false;
     }
 }
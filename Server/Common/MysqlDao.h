@@ -2,7 +2,10 @@
 #include "data.h"
 #include "mysql.h"
 
+#include <atomic>
 #include <memory>
+#include <mutex>
+#include <vector>
 
 class MysqlDao
 {
@@ -11,21 +14,61 @@ class MysqlDao
     ~MysqlDao();
     int  RegUser(const std::string& name, const std::string& email,
          const std::string& pwd, const std::string& icon);
-    bool CheckEmail(const std::string& name, const std::string& email);
+    bool CheckEmail(const std::string& name, const std::string& email,
+        bool primary = false);
     bool UpdatePwd(const std::string& name, const std::string& newpwd);
-    bool CheckPwd(
-        const std::string& email, const std::string& pwd, UserInfo& userInfo);
+    bool CheckPwd(const std::string& email, const std::string& pwd,
+        UserInfo& userInfo, bool primary = false);
     bool AddFriendApply(const int from, const int to);
+    // 一个事务内批量写入好友申请, 供写后队列使用
+    bool AddFriendApplies(const std::vector<std::pair<int, int>>& applies);
     bool AuthFriendApply(const int from, const int to);
     bool AddFriend(const int from, const int to, const std::string& back_name);
-    std::shared_ptr<UserInfo> GetUser(const int uid);
-    std::shared_ptr<UserInfo> GetUser(const std::string& name);
+    std::shared_ptr<UserInfo> GetUser(const int uid, bool primary = false);
+    std::shared_ptr<UserInfo> GetUser(
+        const std::string& name, bool primary = false);
+    // 一次查询批量获取用户信息, 不存在的uid不出现在结果中
+    bool GetUsers(const std::vector<int>&       uids,
+        std::vector<std::shared_ptr<UserInfo>>& users, bool primary = false);
     bool                      GetApplyList(const int                  touid,
                              std::vector<std::shared_ptr<ApplyInfo>>& applyList, int offset,
-                             int limit);
-    bool                      GetFriendList(
-                             const int self_id, std::vector<std::shared_ptr<UserInfo>>& user_info);
+                             int limit, bool primary = false);
+    bool                      GetFriendList(const int self_id,
+                             std::vector<std::shared_ptr<UserInfo>>& user_info,
+                             bool primary = false);
+    // 按friend.id游标分页, next_id为0表示没有下一页
+    bool GetFriendPage(const int self_id, const int after_id, const int limit,
+        std::vector<std::shared_ptr<UserInfo>>& user_info, int& next_id,
+        bool primary = false);
+    bool GetFriendVersion(const int self_id, int& total, std::string& etag,
+        bool primary = false);
+    // 拉取uid在since_version之后的好友变更, more表示还有未返回的记录
+    bool GetFriendChanges(const int uid, const int64_t since_version,
+        const int limit, std::vector<FriendChange>& changes, bool& more,
+        bool primary = false);
+    bool GetFriendSyncVersion(
+        const int uid, int64_t& version, bool primary = false);
 
   private:
-    std::unique_ptr<MySQLPool> pool_;
+    struct Replica
+    {
+        std::string                name;
+        std::unique_ptr<MySQLPool> pool;
+        int                        weight;
+        std::atomic<int64_t>       down_until;  // 摘除截止时间(ms)
+    };
+
+    // 读连接: 按权重选从库, 从库不可用时回退主库
+    MySQL::ptr getReadConn(bool primary);
+    // 从本进程预留的uid段中分配, 用完后再向user_id表预留下一段
+    int allocUid(MySQL::ptr con);
+
+    std::unique_ptr<MySQLPool>            pool_;  // 主库, 所有写操作走这里
+    std::vector<std::unique_ptr<Replica>> replicas_;
+    int                                   total_weight_;
+
+    std::mutex uid_mutex_;
+    int        uid_block_;
+    int        uid_next_;  // 下一个可分配的uid
+    int        uid_end_;   // 当前段的最后一个uid
 };
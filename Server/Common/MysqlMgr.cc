@@ -1,6 +1,8 @@
 #include "MysqlMgr.h"
+#include "ConfigMgr.h"
+#include "const.h"
 
-MysqlMgr::~MysqlMgr() {}
+MysqlMgr::~MysqlMgr() { workers_->Stop(); }
 
 int MysqlMgr::RegUser(const std::string& name, const std::string& email,
     const std::string& pwd, const std::string& icon)
@@ -8,9 +10,10 @@ int MysqlMgr::RegUser(const std::string& name, const std::string& email,
     return dao_.RegUser(name, email, pwd, icon);
 }
 
-bool MysqlMgr::CheckEmail(const std::string& name, const std::string& email)
+bool MysqlMgr::CheckEmail(
+    const std::string& name, const std::string& email, bool primary)
 {
-    return dao_.CheckEmail(name, email);
+    return dao_.CheckEmail(name, email, primary);
 }
 
 bool MysqlMgr::UpdatePwd(const std::string& name, const std::string& newpwd)
@@ -18,12 +21,24 @@ bool MysqlMgr::UpdatePwd(const std::string& name, const std::string& newpwd)
     return dao_.UpdatePwd(name, newpwd);
 }
 
-MysqlMgr::MysqlMgr() {}
+MysqlMgr::MysqlMgr()
+{
+    auto& cfg         = ConfigMgr::Inst();
+    auto  threads     = cfg["Mysql"]["AsyncThreads"];
+    auto  queue_size  = cfg["Mysql"]["AsyncQueueSize"];
+    auto  deadline_ms = cfg["Mysql"]["QueryDeadline"];
+
+    // 只限制排队时间, 查询本身受连接的读写超时限制
+    deadline_ = std::chrono::milliseconds(
+        deadline_ms.empty() ? 3000 : stoi(deadline_ms));
+    workers_.reset(new WorkerPool(threads.empty() ? 4 : stoul(threads),
+        queue_size.empty() ? 1024 : stoul(queue_size)));
+}
 
-bool MysqlMgr::CheckPwd(
-    const std::string& email, const std::string& pwd, UserInfo& userInfo)
+bool MysqlMgr::CheckPwd(const std::string& email, const std::string& pwd,
+    UserInfo& userInfo, bool primary)
 {
-    return dao_.CheckPwd(email, pwd, userInfo);
+    return dao_.CheckPwd(email, pwd, userInfo, primary);
 }
 
 bool MysqlMgr::AddFriendApply(const int from, const int to)
@@ -31,6 +46,12 @@ bool MysqlMgr::AddFriendApply(const int from, const int to)
     return dao_.AddFriendApply(from, to);
 }
 
+bool MysqlMgr::AddFriendApplies(
+    const std::vector<std::pair<int, int>>& applies)
+{
+    return dao_.AddFriendApplies(applies);
+}
+
 bool MysqlMgr::AuthFriendApply(const int from, const int to)
 {
     return dao_.AuthFriendApply(from, to);
@@ -42,25 +63,163 @@ bool MysqlMgr::AddFriend(
     return dao_.AddFriend(from, to, back_name);
 }
 
-std::shared_ptr<UserInfo> MysqlMgr::GetUser(int uid)
+std::shared_ptr<UserInfo> MysqlMgr::GetUser(int uid, bool primary)
+{
+    return dao_.GetUser(uid, primary);
+}
+
+std::shared_ptr<UserInfo> MysqlMgr::GetUser(
+    const std::string& name, bool primary)
 {
-    return dao_.GetUser(uid);
+    return dao_.GetUser(name, primary);
 }
 
-std::shared_ptr<UserInfo> MysqlMgr::GetUser(const std::string& name)
+bool MysqlMgr::GetUsers(const std::vector<int>& uids,
+    std::vector<std::shared_ptr<UserInfo>>&     users, bool primary)
 {
-    return dao_.GetUser(name);
+    return dao_.GetUsers(uids, users, primary);
 }
 
 bool MysqlMgr::GetApplyList(const int        touid,
-    std::vector<std::shared_ptr<ApplyInfo>>& applyList, int begin, int limit)
+    std::vector<std::shared_ptr<ApplyInfo>>& applyList, int begin, int limit,
+    bool primary)
 {
+    return dao_.GetApplyList(touid, applyList, begin, limit, primary);
+}
 
-    return dao_.GetApplyList(touid, applyList, begin, limit);
+bool MysqlMgr::GetFriendList(const int          self_id,
+    std::vector<std::shared_ptr<UserInfo>>& user_info, bool primary)
+{
+    return dao_.GetFriendList(self_id, user_info, primary);
+}
+
+bool MysqlMgr::GetFriendPage(const int self_id, const int after_id,
+    const int limit, std::vector<std::shared_ptr<UserInfo>>& user_info,
+    int& next_id, bool primary)
+{
+    return dao_.GetFriendPage(
+        self_id, after_id, limit, user_info, next_id, primary);
+}
+
+bool MysqlMgr::GetFriendVersion(
+    const int self_id, int& total, std::string& etag, bool primary)
+{
+    return dao_.GetFriendVersion(self_id, total, etag, primary);
+}
+
+bool MysqlMgr::GetFriendChanges(const int uid, const int64_t since_version,
+    const int limit, std::vector<FriendChange>& changes, bool& more,
+    bool primary)
+{
+    return dao_.GetFriendChanges(
+        uid, since_version, limit, changes, more, primary);
+}
+
+bool MysqlMgr::GetFriendSyncVersion(
+    const int uid, int64_t& version, bool primary)
+{
+    return dao_.GetFriendSyncVersion(uid, version, primary);
+}
+
+void MysqlMgr::RegUserAsync(const std::string& name, const std::string& email,
+    const std::string& pwd, const std::string& icon, IntCallback cb)
+{
+    post([this, name, email, pwd, icon,
+             cb]() { cb(dao_.RegUser(name, email, pwd, icon)); },
+        [cb]() { cb(-1); });
+}
+
+void MysqlMgr::CheckEmailAsync(const std::string& name,
+    const std::string& email, BoolCallback cb, bool primary)
+{
+    post([this, name, email, cb,
+             primary]() { cb(dao_.CheckEmail(name, email, primary)); },
+        [cb]() { cb(false); });
+}
+
+void MysqlMgr::UpdatePwdAsync(
+    const std::string& name, const std::string& newpwd, BoolCallback cb)
+{
+    post([this, name, newpwd, cb]() { cb(dao_.UpdatePwd(name, newpwd)); },
+        [cb]() { cb(false); });
+}
+
+void MysqlMgr::CheckPwdAsync(const std::string& email, const std::string& pwd,
+    CheckPwdCallback cb, bool primary)
+{
+    post(
+        [this, email, pwd, cb, primary]() {
+            UserInfo userInfo;
+            bool     ok = dao_.CheckPwd(email, pwd, userInfo, primary);
+            cb(ok ? ErrorCodes::Success : ErrorCodes::PasswdInvalid, userInfo);
+        },
+        [cb]() {
+            UserInfo userInfo;
+            cb(ErrorCodes::RPCFailed, userInfo);
+        });
+}
+
+void MysqlMgr::AddFriendApplyAsync(
+    const int from, const int to, BoolCallback cb)
+{
+    post([this, from, to, cb]() { cb(dao_.AddFriendApply(from, to)); },
+        [cb]() { cb(false); });
+}
+
+void MysqlMgr::AuthFriendApplyAsync(
+    const int from, const int to, BoolCallback cb)
+{
+    post([this, from, to, cb]() { cb(dao_.AuthFriendApply(from, to)); },
+        [cb]() { cb(false); });
+}
+
+void MysqlMgr::AddFriendAsync(const int from, const int to,
+    const std::string& back_name, BoolCallback cb)
+{
+    post([this, from, to, back_name,
+             cb]() { cb(dao_.AddFriend(from, to, back_name)); },
+        [cb]() { cb(false); });
+}
+
+void MysqlMgr::GetUserAsync(const int uid, UserCallback cb, bool primary)
+{
+    post([this, uid, cb, primary]() { cb(dao_.GetUser(uid, primary)); },
+        [cb]() { cb(nullptr); });
+}
+
+void MysqlMgr::GetUserAsync(
+    const std::string& name, UserCallback cb, bool primary)
+{
+    post([this, name, cb, primary]() { cb(dao_.GetUser(name, primary)); },
+        [cb]() { cb(nullptr); });
+}
+
+void MysqlMgr::GetApplyListAsync(const int touid, int begin, int limit,
+    ApplyListCallback cb, bool primary)
+{
+    post(
+        [this, touid, begin, limit, cb, primary]() {
+            std::vector<std::shared_ptr<ApplyInfo>> list;
+            bool ok = dao_.GetApplyList(touid, list, begin, limit, primary);
+            cb(ok, list);
+        },
+        [cb]() {
+            std::vector<std::shared_ptr<ApplyInfo>> list;
+            cb(false, list);
+        });
 }
 
-bool MysqlMgr::GetFriendList(
-    const int self_id, std::vector<std::shared_ptr<UserInfo>>& user_info)
+void MysqlMgr::GetFriendListAsync(
+    const int self_id, UserListCallback cb, bool primary)
 {
-    return dao_.GetFriendList(self_id, user_info);
+    post(
+        [this, self_id, cb, primary]() {
+            std::vector<std::shared_ptr<UserInfo>> list;
+            bool ok = dao_.GetFriendList(self_id, list, primary);
+            cb(ok, list);
+        },
+        [cb]() {
+            std::vector<std::shared_ptr<UserInfo>> list;
+            cb(false, list);
+        });
 }
@@ -1,8 +1,10 @@
 #pragma once
 #include "MysqlDao.h"
 #include "Singleton.h"
+#include "WorkerPool.h"
 #include "data.h"
 
+#include <functional>
 #include <vector>
 
 class MysqlMgr : public Singleton<MysqlMgr>
@@ -10,26 +12,90 @@ class MysqlMgr : public Singleton<MysqlMgr>
     friend class Singleton<MysqlMgr>;
 
   public:
+    typedef std::function<void(bool)>                      BoolCallback;
+    typedef std::function<void(int)>                       IntCallback;
+    typedef std::function<void(std::shared_ptr<UserInfo>)> UserCallback;
+    // 第一个参数为 ErrorCodes, 排队失败时为 RPCFailed, 与密码错误区分
+    typedef std::function<void(int, UserInfo&)>            CheckPwdCallback;
+    typedef std::function<void(bool, std::vector<std::shared_ptr<UserInfo>>&)>
+        UserListCallback;
+    typedef std::function<void(bool, std::vector<std::shared_ptr<ApplyInfo>>&)>
+        ApplyListCallback;
+
     ~MysqlMgr();
     int  RegUser(const std::string& name, const std::string& email,
          const std::string& pwd, const std::string& icon);
-    bool CheckEmail(const std::string& name, const std::string& email);
+    // 读操作默认路由到从库, primary 为 true 时读主库(用于写后立即读)
+    bool CheckEmail(const std::string& name, const std::string& email,
+        bool primary = false);
     bool UpdatePwd(const std::string& name, const std::string& newpwd);
-    bool CheckPwd(
-        const std::string& email, const std::string& pwd, UserInfo& userInfo);
+    bool CheckPwd(const std::string& email, const std::string& pwd,
+        UserInfo& userInfo, bool primary = false);
     bool AddFriendApply(const int from, const int to);
+    // 一个事务内批量写入好友申请, 供写后队列使用
+    bool AddFriendApplies(const std::vector<std::pair<int, int>>& applies);
     bool AuthFriendApply(const int from, const int to);
     bool AddFriend(const int from, const int to, const std::string& back_name);
-    std::shared_ptr<UserInfo> GetUser(const int uid);
-    std::shared_ptr<UserInfo> GetUser(const std::string& name);
+    std::shared_ptr<UserInfo> GetUser(const int uid, bool primary = false);
+    std::shared_ptr<UserInfo> GetUser(
+        const std::string& name, bool primary = false);
+    // 一次查询批量获取用户信息, 不存在的uid不出现在结果中
+    bool GetUsers(const std::vector<int>&       uids,
+        std::vector<std::shared_ptr<UserInfo>>& users, bool primary = false);
 
     bool GetApplyList(const int                  touid,
         std::vector<std::shared_ptr<ApplyInfo>>& applyList, int begin,
-        int limit = 10);
-    bool GetFriendList(
-        const int self_id, std::vector<std::shared_ptr<UserInfo>>& user_info);
+        int limit = 10, bool primary = false);
+    bool GetFriendList(const int                 self_id,
+        std::vector<std::shared_ptr<UserInfo>>& user_info,
+        bool                                    primary = false);
+    bool GetFriendPage(const int self_id, const int after_id, const int limit,
+        std::vector<std::shared_ptr<UserInfo>>& user_info, int& next_id,
+        bool primary = false);
+    bool GetFriendVersion(const int self_id, int& total, std::string& etag,
+        bool primary = false);
+    bool GetFriendChanges(const int uid, const int64_t since_version,
+        const int limit, std::vector<FriendChange>& changes, bool& more,
+        bool primary = false);
+    bool GetFriendSyncVersion(
+        const int uid, int64_t& version, bool primary = false);
+
+    // 异步版本在DB线程池中执行, 回调也在DB线程中调用
+    // 队列已满或排队超过截止时间时直接以失败结果回调
+    // 读操作的 primary 含义与同步版本相同
+    void RegUserAsync(const std::string& name, const std::string& email,
+        const std::string& pwd, const std::string& icon, IntCallback cb);
+    void CheckEmailAsync(const std::string& name, const std::string& email,
+        BoolCallback cb, bool primary = false);
+    void UpdatePwdAsync(
+        const std::string& name, const std::string& newpwd, BoolCallback cb);
+    void CheckPwdAsync(const std::string& email, const std::string& pwd,
+        CheckPwdCallback cb, bool primary = false);
+    void AddFriendApplyAsync(const int from, const int to, BoolCallback cb);
+    void AuthFriendApplyAsync(const int from, const int to, BoolCallback cb);
+    void AddFriendAsync(const int from, const int to,
+        const std::string& back_name, BoolCallback cb);
+    void GetUserAsync(const int uid, UserCallback cb, bool primary = false);
+    void GetUserAsync(
+        const std::string& name, UserCallback cb, bool primary = false);
+    void GetApplyListAsync(const int touid, int begin, int limit,
+        ApplyListCallback cb, bool primary = false);
+    void GetFriendListAsync(
+        const int self_id, UserListCallback cb, bool primary = false);
 
   private:
     MysqlMgr();
-    MysqlDao dao_;
+
+    template <typename Work, typename Fail>
+    void post(Work work, Fail fail)
+    {
+        if (!workers_->Post(work, deadline_, fail))
+        {
+            fail();
+        }
+    }
+
+    MysqlDao                    dao_;
+    std::unique_ptr<WorkerPool> workers_;
+    std::chrono::milliseconds   deadline_;
 };
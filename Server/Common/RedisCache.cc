@@ -0,0 +1,266 @@
+#include "RedisCache.h"
+
+#include <chrono>
+#include <functional>
+#include <iostream>
+
+#define INVALIDATE_CHANNEL "__redis__:invalidate"
+
+RedisCache::RedisCache(const std::string& host, int32_t port,
+    const std::string& passwd, const std::vector<std::string>& prefixes,
+    size_t capacity)
+    : host_(host),
+      port_(port),
+      passwd_(passwd),
+      prefixes_(prefixes),
+      capacity_(capacity),
+      stopped_(true),
+      tracking_(false),
+      hits_(0),
+      misses_(0)
+{
+    for (auto& gen : gens_)
+    {
+        gen = 0;
+    }
+}
+
+RedisCache::~RedisCache() { Stop(); }
+
+void RedisCache::Start()
+{
+    if (!stopped_)
+    {
+        return;
+    }
+    stopped_ = false;
+    thread_  = std::thread(&RedisCache::Run, this);
+}
+
+void RedisCache::Stop()
+{
+    stopped_ = true;
+    if (thread_.joinable())
+    {
+        thread_.join();
+    }
+}
+
+bool RedisCache::Cacheable(const std::string& key) const
+{
+    for (auto& prefix : prefixes_)
+    {
+        if (key.compare(0, prefix.size(), prefix) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool RedisCache::Get(const std::string& key, std::string& value)
+{
+    if (!tracking_)
+    {
+        misses_++;
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto                        it = items_.find(key);
+    if (it == items_.end())
+    {
+        misses_++;
+        return false;
+    }
+    // 移到链表头部
+    lru_.splice(lru_.begin(), lru_, it->second);
+    value = it->second->second;
+    hits_++;
+    return true;
+}
+
+uint64_t RedisCache::Generation(const std::string& key) const
+{
+    return gens_[std::hash<std::string>()(key) % kGenerationSlots];
+}
+
+void RedisCache::Put(
+    const std::string& key, const std::string& value, uint64_t gen)
+{
+    if (!tracking_)
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (gen != Generation(key))
+    {
+        return;
+    }
+
+    auto it = items_.find(key);
+    if (it != items_.end())
+    {
+        it->second->second = value;
+        lru_.splice(lru_.begin(), lru_, it->second);
+        return;
+    }
+
+    lru_.emplace_front(key, value);
+    items_[key] = lru_.begin();
+    if (items_.size() > capacity_)
+    {
+        items_.erase(lru_.back().first);
+        lru_.pop_back();
+    }
+}
+
+void RedisCache::Invalidate(const std::string& key)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    erase(key);
+}
+
+void RedisCache::erase(const std::string& key)
+{
+    gens_[std::hash<std::string>()(key) % kGenerationSlots]++;
+    auto it = items_.find(key);
+    if (it != items_.end())
+    {
+        lru_.erase(it->second);
+        items_.erase(it);
+    }
+}
+
+void RedisCache::Clear()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& gen : gens_)
+    {
+        gen++;
+    }
+    lru_.clear();
+    items_.clear();
+}
+
+bool RedisCache::Connect()
+{
+    sub_.reset(new Redis(host_, port_, passwd_));
+    ctl_.reset(new Redis(host_, port_, passwd_));
+    if (!sub_->connect() || !ctl_->connect())
+    {
+        return false;
+    }
+    ctl_->setTimeout(100);
+
+    auto id = sub_->cmd("CLIENT ID");
+    if (id == nullptr || id->type != REDIS_REPLY_INTEGER)
+    {
+        return false;
+    }
+
+    // 先订阅再开启 tracking, 避免丢失开启后的第一批失效消息
+    sub_->appendCmd("SUBSCRIBE %s", INVALIDATE_CHANNEL);
+    if (!sub_->flush())
+    {
+        return false;
+    }
+    ReplyPtr reply;
+    if (sub_->waitReply(reply, 1000) <= 0)
+    {
+        return false;
+    }
+
+    std::vector<std::string> prefix_args;
+    for (auto& prefix : prefixes_)
+    {
+        prefix_args.push_back("PREFIX");
+        prefix_args.push_back(prefix);
+    }
+    if (ctl_->exec("CLIENT", "TRACKING", "ON", "REDIRECT", id->integer,
+            "BCAST", prefix_args) == nullptr)
+    {
+        return false;
+    }
+    return true;
+}
+
+void RedisCache::Disconnect()
+{
+    // 连接断开期间可能错过失效消息, 缓存全部作废
+    tracking_ = false;
+    Clear();
+    sub_.reset();
+    ctl_.reset();
+}
+
+void RedisCache::OnInvalidate(const ReplyPtr& reply)
+{
+    if (reply->type != REDIS_REPLY_ARRAY || reply->elements < 3)
+    {
+        return;
+    }
+    auto payload = reply->element[2];
+    // 空消息表示 redis 执行了 FLUSHALL/FLUSHDB
+    if (payload->type != REDIS_REPLY_ARRAY)
+    {
+        Clear();
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < payload->elements; ++i)
+    {
+        erase(std::string(payload->element[i]->str, payload->element[i]->len));
+    }
+}
+
+void RedisCache::Run()
+{
+    int  retry_ms = 100;
+    auto last_ping = std::chrono::steady_clock::now();
+    while (!stopped_)
+    {
+        if (!tracking_)
+        {
+            if (!Connect())
+            {
+                Disconnect();
+                std::cout << "RedisCache tracking connect failed: (" << host_
+                          << ":" << port_ << ")" << std::endl;
+                std::this_thread::sleep_for(
+                    std::chrono::milliseconds(retry_ms));
+                retry_ms = std::min(retry_ms * 2, 5000);
+                continue;
+            }
+            tracking_ = true;
+            retry_ms  = 100;
+            last_ping = std::chrono::steady_clock::now();
+        }
+
+        ReplyPtr reply;
+        int      rt = sub_->waitReply(reply, 200);
+        if (rt < 0)
+        {
+            Disconnect();
+            continue;
+        }
+        if (rt > 0)
+        {
+            OnInvalidate(reply);
+        }
+
+        // tracking 状态挂在 ctl_ 上, 它断开后不会再有失效消息, 需要主动探测
+        auto now = std::chrono::steady_clock::now();
+        if (now - last_ping > std::chrono::seconds(1))
+        {
+            last_ping = now;
+            if (ctl_->cmd("PING") == nullptr)
+            {
+                Disconnect();
+            }
+        }
+    }
+    Disconnect();
+}
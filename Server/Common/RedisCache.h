@@ -0,0 +1,75 @@
+#pragma once
+
+#include "redis.h"
+
+#include <atomic>
+#include <list>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// 基于 CLIENT TRACKING 的本地缓存
+// 只缓存配置了前缀的 key, redis 在 key 变更时推送失效消息保证一致
+// 失效消息通过 REDIRECT 投递到订阅了 __redis__:invalidate 的连接上
+class RedisCache
+{
+  public:
+    RedisCache(const std::string& host, int32_t port, const std::string& passwd,
+        const std::vector<std::string>& prefixes, size_t capacity);
+    ~RedisCache();
+
+    void Start();
+    void Stop();
+
+    // key 是否属于需要缓存的前缀
+    bool Cacheable(const std::string& key) const;
+
+    bool Get(const std::string& key, std::string& value);
+    // gen 为读取 redis 之前调用 Generation(key) 得到的值
+    // 期间该 key 发生过失效则放弃写入, 防止旧值覆盖
+    void     Put(const std::string& key, const std::string& value,
+            uint64_t gen);
+    void     Invalidate(const std::string& key);
+    uint64_t Generation(const std::string& key) const;
+
+    uint64_t Hits() const { return hits_; }
+    uint64_t Misses() const { return misses_; }
+
+  private:
+    void Run();
+    bool Connect();
+    void Disconnect();
+    void OnInvalidate(const ReplyPtr& reply);
+    void Clear();
+    // 调用方需持有 mutex_
+    void erase(const std::string& key);
+
+    typedef std::list<std::pair<std::string, std::string>> LruList;
+
+    // 失效版本号按 key 的哈希分段, 一个 key 失效只影响同段 key 的回填
+    static const size_t kGenerationSlots = 1024;
+
+    std::string              host_;
+    int32_t                  port_;
+    std::string              passwd_;
+    std::vector<std::string> prefixes_;
+    size_t                   capacity_;
+
+    // sub_ 订阅失效频道, ctl_ 开启 tracking 并重定向到 sub_
+    std::unique_ptr<Redis> sub_;
+    std::unique_ptr<Redis> ctl_;
+    std::thread            thread_;
+    std::atomic<bool>      stopped_;
+    // tracking 正常时才允许读写缓存
+    std::atomic<bool>      tracking_;
+
+    std::mutex                                        mutex_;
+    LruList                                           lru_;
+    std::unordered_map<std::string, LruList::iterator> items_;
+
+    std::atomic<uint64_t> gens_[kGenerationSlots];
+    std::atomic<uint64_t> hits_;
+    std::atomic<uint64_t> misses_;
+};
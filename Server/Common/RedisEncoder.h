@@ -0,0 +1,74 @@
+#pragma once
+
+#include <charconv>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+// RESP 命令编码器
+// 参数按长度写入, 对空格和二进制数据安全, 不再经过 printf 风格的格式串解析
+// 缓冲区随连接复用, 编码时不产生额外的参数拷贝
+class RedisEncoder
+{
+  public:
+    template <typename... Args>
+    void encode(const Args&... args)
+    {
+        buf_.clear();
+        size_t argc = 0;
+        (count(argc, args), ...);
+        header('*', argc);
+        (append(args), ...);
+    }
+
+    const char* data() const { return buf_.data(); }
+    size_t      size() const { return buf_.size(); }
+
+  private:
+    static void count(size_t& argc, const std::vector<std::string>& v)
+    {
+        argc += v.size();
+    }
+
+    template <typename T>
+    static void count(size_t& argc, const T&)
+    {
+        argc++;
+    }
+
+    void header(char type, size_t n)
+    {
+        char buf[24];
+        auto r = std::to_chars(buf, buf + sizeof(buf), n);
+        buf_.push_back(type);
+        buf_.append(buf, r.ptr - buf);
+        buf_.append("\r\n", 2);
+    }
+
+    void append(std::string_view s)
+    {
+        header('$', s.size());
+        buf_.append(s.data(), s.size());
+        buf_.append("\r\n", 2);
+    }
+
+    template <typename T,
+        typename = std::enable_if_t<std::is_integral<T>::value>>
+    void append(T v)
+    {
+        char buf[24];
+        auto r = std::to_chars(buf, buf + sizeof(buf), v);
+        append(std::string_view(buf, r.ptr - buf));
+    }
+
+    void append(const std::vector<std::string>& v)
+    {
+        for (auto& s : v)
+        {
+            append(std::string_view(s));
+        }
+    }
+
+    std::string buf_;
+};
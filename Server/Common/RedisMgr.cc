@@ -1,8 +1,63 @@
 #include "RedisMgr.h"
 #include "ConfigMgr.h"
 #include "DistLock.h"
+#include "RedisScript.h"
 #include "const.h"
 
+#include <atomic>
+#include <random>
+#include <sstream>
+
+// 读取旧的登录信息并写入新的, 一次往返完成, 不需要分布式锁
+static RedisScript kClaimLoginScript(
+    "local ip = redis.call('get', KEYS[1]) "
+    "local sid = redis.call('get', KEYS[2]) "
+    "redis.call('set', KEYS[1], ARGV[1]) "
+    "redis.call('set', KEYS[2], ARGV[2]) "
+    "return {ip or '', sid or ''}");
+
+// 只有 usession 仍是该 session 时才清除登录信息
+static RedisScript kReleaseLoginScript(
+    "if redis.call('get', KEYS[2]) == ARGV[1] then "
+    "  redis.call('del', KEYS[1], KEYS[2]) "
+    "  return 1 "
+    "end "
+    "return 0");
+
+// 校验 token, 不存在返回 -1
+static RedisScript kVerifyTokenScript(
+    "local t = redis.call('get', KEYS[1]) "
+    "if not t then return -1 end "
+    "if t == ARGV[1] then return 1 end "
+    "return 0");
+
+// 登录数变更后通知订阅者, 消息格式为 name:count
+static RedisScript kIncrCountScript(
+    "local c = redis.call('hincrby', KEYS[1], ARGV[1], ARGV[2]) "
+    "redis.call('publish', ARGV[3], ARGV[1] .. ':' .. c) "
+    "return c");
+
+static RedisScript kSetCountScript(
+    "redis.call('hset', KEYS[1], ARGV[1], ARGV[2]) "
+    "redis.call('publish', ARGV[3], ARGV[1] .. ':' .. ARGV[2]) "
+    "return 1");
+
+// 服务器下线时发布 -1
+static RedisScript kDelCountScript(
+    "redis.call('hdel', KEYS[1], ARGV[1]) "
+    "redis.call('publish', ARGV[2], ARGV[1] .. ':-1') "
+    "return 1");
+
+// 使用 redis 的时间, 多个实例之间不依赖本机时钟
+static RedisScript kSlidingWindowScript(
+    "local t = redis.call('time') "
+    "local now = t[1] * 1000 + math.floor(t[2] / 1000) "
+    "redis.call('zremrangebyscore', KEYS[1], 0, now - tonumber(ARGV[1])) "
+    "if redis.call('zcard', KEYS[1]) >= tonumber(ARGV[2]) then return 0 end "
+    "redis.call('zadd', KEYS[1], now, ARGV[3]) "
+    "redis.call('pexpire', KEYS[1], ARGV[1]) "
+    "return 1");
+
 RedisMgr::RedisMgr()
 {
     auto& gCfgMgr = ConfigMgr::Inst();
@@ -10,18 +65,59 @@ RedisMgr::RedisMgr()
     auto  port    = gCfgMgr["Redis"]["Port"];
     auto  pwd     = gCfgMgr["Redis"]["Passwd"];
     con_pool_.reset(new RedisPool(host, stoi(port), pwd, 10));
+    RedisScript::LoadAll(con_pool_->get());
+
+    // 读多写少的 key 开启本地缓存, 由 redis 的失效通知保证一致
+    if (gCfgMgr["Redis"]["Tracking"] == "true")
+    {
+        std::vector<std::string> prefixes;
+        std::stringstream        ss(gCfgMgr["Redis"]["TrackingPrefixes"]);
+        std::string              prefix;
+        while (std::getline(ss, prefix, ','))
+        {
+            if (!prefix.empty())
+            {
+                prefixes.push_back(prefix);
+            }
+        }
+
+        auto capacity = gCfgMgr["Redis"]["TrackingCapacity"];
+        if (!prefixes.empty())
+        {
+            cache_.reset(new RedisCache(host, stoi(port), pwd, prefixes,
+                capacity.empty() ? 10000 : stoul(capacity)));
+            cache_->Start();
+        }
+    }
 }
 
-RedisMgr::~RedisMgr() {}
+RedisMgr::~RedisMgr()
+{
+    if (cache_)
+    {
+        cache_->Stop();
+    }
+}
 
 bool RedisMgr::Get(const std::string& key, std::string& value)
 {
+    bool     cacheable = cache_ && cache_->Cacheable(key);
+    uint64_t gen       = 0;
+    if (cacheable)
+    {
+        if (cache_->Get(key, value))
+        {
+            return true;
+        }
+        gen = cache_->Generation(key);
+    }
+
     auto connect = con_pool_->get();
     if (connect == nullptr)
     {
         return false;
     }
-    auto reply = connect->cmd("GET %s", key.c_str());
+    auto reply = connect->exec("GET", key);
     if (reply == nullptr)
     {
         std::cout << "[ GET  " << key << " ] failed" << std::endl;
@@ -34,7 +130,11 @@ bool RedisMgr::Get(const std::string& key, std::string& value)
         return false;
     }
 
-    value = reply->str;
+    value.assign(reply->str, reply->len);
+    if (cacheable)
+    {
+        cache_->Put(key, value, gen);
+    }
 
     std::cout << "Succeed to execute command [ GET " << key << "  ]"
               << std::endl;
@@ -49,7 +149,7 @@ bool RedisMgr::Set(const std::string& key, const std::string& value)
     {
         return false;
     }
-    auto reply = connect->cmd("SET %s %s", key.c_str(), value.c_str());
+    auto reply = connect->exec("SET", key, value);
 
     // 如果返回NULL则说明执行失败
     if (nullptr == reply)
@@ -68,11 +168,80 @@ bool RedisMgr::Set(const std::string& key, const std::string& value)
         return false;
     }
 
+    // 失效通知是异步到达的, 本进程的写入先在本地失效
+    if (cache_ && cache_->Cacheable(key))
+    {
+        cache_->Invalidate(key);
+    }
+
     std::cout << "Execut command [ SET " << key << "  " << value << " ] success"
               << std::endl;
     return true;
 }
 
+bool RedisMgr::MGet(const std::vector<std::string>& keys,
+    std::vector<std::string>& values, std::vector<bool>& found)
+{
+    values.assign(keys.size(), "");
+    found.assign(keys.size(), false);
+
+    // 先查本地缓存, 只有未命中的key才发往redis
+    std::vector<std::string> miss_keys;
+    std::vector<size_t>      miss_index;
+    std::vector<uint64_t>    miss_gens;
+    for (size_t i = 0; i < keys.size(); ++i)
+    {
+        if (cache_ && cache_->Cacheable(keys[i]) &&
+            cache_->Get(keys[i], values[i]))
+        {
+            found[i] = true;
+            continue;
+        }
+        miss_keys.push_back(keys[i]);
+        miss_index.push_back(i);
+        miss_gens.push_back(cache_ ? cache_->Generation(keys[i]) : 0);
+    }
+
+    if (miss_keys.empty())
+    {
+        return true;
+    }
+
+    auto connect = con_pool_->get();
+    if (connect == nullptr)
+    {
+        return false;
+    }
+    auto reply = connect->exec("MGET", miss_keys);
+    if (reply == nullptr || reply->type != REDIS_REPLY_ARRAY ||
+        reply->elements != miss_keys.size())
+    {
+        std::cout << "[ MGET " << miss_keys.size() << " keys ] failed"
+                  << std::endl;
+        return false;
+    }
+
+    for (size_t j = 0; j < miss_keys.size(); ++j)
+    {
+        auto element = reply->element[j];
+        if (element->type != REDIS_REPLY_STRING)
+        {
+            continue;
+        }
+        size_t i = miss_index[j];
+        values[i].assign(element->str, element->len);
+        found[i] = true;
+        if (cache_ && cache_->Cacheable(keys[i]))
+        {
+            cache_->Put(keys[i], values[i], miss_gens[j]);
+        }
+    }
+
+    std::cout << "Succeed to execute command [ MGET " << miss_keys.size()
+              << " keys ]" << std::endl;
+    return true;
+}
+
 bool RedisMgr::LPush(const std::string& key, const std::string& value)
 {
     auto connect = con_pool_->get();
@@ -80,7 +249,7 @@ bool RedisMgr::LPush(const std::string& key, const std::string& value)
     {
         return false;
     }
-    auto reply = connect->cmd("LPUSH %s %s", key.c_str(), value.c_str());
+    auto reply = connect->exec("LPUSH", key, value);
     if (nullptr == reply)
     {
         std::cout << "Execut command [ LPUSH " << key << "  " << value
@@ -110,7 +279,7 @@ bool RedisMgr::LPop(const std::string& key, std::string& value)
     {
         return false;
     }
-    auto reply = connect->cmd("LPOP %s ", key.c_str());
+    auto reply = connect->exec("LPOP", key);
     if (reply == nullptr)
     {
         std::cout << "Execut command [ LPOP " << key << " ] failure"
@@ -127,7 +296,7 @@ bool RedisMgr::LPop(const std::string& key, std::string& value)
         return false;
     }
 
-    value = reply->str;
+    value.assign(reply->str, reply->len);
     std::cout << "Execut command [ LPOP " << key << " ] success" << std::endl;
 
     return true;
@@ -140,7 +309,7 @@ bool RedisMgr::RPush(const std::string& key, const std::string& value)
     {
         return false;
     }
-    auto reply = connect->cmd("RPUSH %s %s", key.c_str(), value.c_str());
+    auto reply = connect->exec("RPUSH", key, value);
     if (nullptr == reply)
     {
         std::cout << "Execut command [ RPUSH " << key << "  " << value
@@ -169,7 +338,7 @@ bool RedisMgr::RPop(const std::string& key, std::string& value)
     {
         return false;
     }
-    auto reply = connect->cmd("RPOP %s ", key.c_str());
+    auto reply = connect->exec("RPOP", key);
     if (reply == nullptr)
     {
         std::cout << "Execut command [ RPOP " << key << " ] failure"
@@ -185,7 +354,7 @@ bool RedisMgr::RPop(const std::string& key, std::string& value)
 
         return false;
     }
-    value = reply->str;
+    value.assign(reply->str, reply->len);
     std::cout << "Execut command [ RPOP " << key << " ] success" << std::endl;
 
     return true;
@@ -199,8 +368,7 @@ bool RedisMgr::HSet(
     {
         return false;
     }
-    auto reply =
-        connect->cmd("HSET %s %s %s", key.c_str(), hkey.c_str(), value.c_str());
+    auto reply = connect->exec("HSET", key, hkey, value);
     if (reply == nullptr)
     {
         std::cout << "Execut command [ HSet " << key << "  " << hkey << "  "
@@ -231,7 +399,7 @@ std::string RedisMgr::HGet(const std::string& key, const std::string& hkey)
         return "";
     }
 
-    auto reply = connect->cmd({"HGET", key, hkey});
+    auto reply = connect->exec("HGET", key, hkey);
     if (reply == nullptr)
     {
         std::cout << "Execut command [ HGet " << key << " " << hkey
@@ -249,7 +417,7 @@ std::string RedisMgr::HGet(const std::string& key, const std::string& hkey)
         return "";
     }
 
-    std::string value = reply->str;
+    std::string value(reply->str, reply->len);
 
     std::cout << "Execut command [ HGet " << key << " " << hkey << " ] success"
               << std::endl;
@@ -264,7 +432,7 @@ bool RedisMgr::HDel(const std::string& key, const std::string& field)
         return false;
     }
 
-    auto reply = connect->cmd("HDEL %s %s", key.c_str(), field.c_str());
+    auto reply = connect->exec("HDEL", key, field);
     if (reply == nullptr)
     {
         std::cerr << "HDEL command failed" << std::endl;
@@ -287,7 +455,7 @@ bool RedisMgr::Del(const std::string& key)
     {
         return false;
     }
-    auto reply = connect->cmd("DEL %s", key.c_str());
+    auto reply = connect->exec("DEL", key);
     if (reply == nullptr)
     {
         std::cout << "Execut command [ Del " << key << " ] failure"
@@ -304,6 +472,11 @@ bool RedisMgr::Del(const std::string& key)
         return false;
     }
 
+    if (cache_ && cache_->Cacheable(key))
+    {
+        cache_->Invalidate(key);
+    }
+
     std::cout << "Execut command [ Del " << key << " ] success" << std::endl;
 
     return true;
@@ -317,7 +490,7 @@ bool RedisMgr::ExistsKey(const std::string& key)
         return false;
     }
 
-    auto reply = connect->cmd("exists %s", key.c_str());
+    auto reply = connect->exec("EXISTS", key);
     if (reply == nullptr)
     {
         std::cout << "Not Found [ Key " << key << " ] " << std::endl;
@@ -336,10 +509,52 @@ bool RedisMgr::ExistsKey(const std::string& key)
     return true;
 }
 
-std::string RedisMgr::acquireLock(
-    const std::string& lockName, int lockTimeout, int acquireTimeout)
+std::string RedisMgr::XAdd(
+    const std::string& stream, const std::vector<std::string>& fields)
 {
+    auto connect = con_pool_->get();
+    if (connect == nullptr)
+    {
+        return "";
+    }
+    auto reply = connect->exec("XADD", stream, "*", fields);
+    if (reply == nullptr || reply->type != REDIS_REPLY_STRING)
+    {
+        std::cout << "Execut command [ XADD " << stream << " ] failure"
+                  << std::endl;
+        return "";
+    }
+    return std::string(reply->str, reply->len);
+}
 
+int RedisMgr::SlidingWindow(
+    const std::string& key, int64_t window_ms, int64_t limit)
+{
+    auto connect = con_pool_->get();
+    if (connect == nullptr)
+    {
+        return -1;
+    }
+
+    // 成员只需在窗口内唯一
+    static std::atomic<uint64_t> seq{0};
+    static const uint64_t        salt = std::random_device{}();
+    std::string member = std::to_string(salt) + ":" + std::to_string(++seq);
+
+    auto reply = kSlidingWindowScript.exec(connect, {key},
+        {std::to_string(window_ms), std::to_string(limit), member});
+    if (reply == nullptr || reply->type != REDIS_REPLY_INTEGER)
+    {
+        std::cout << "Execut command [ sliding window " << key << " ] failure"
+                  << std::endl;
+        return -1;
+    }
+    return reply->integer;
+}
+
+std::string RedisMgr::acquireLock(const std::string& lockName,
+    int lockTimeout, int acquireTimeout, int64_t* fence)
+{
     auto connect = con_pool_->get();
     if (connect == nullptr)
     {
@@ -349,7 +564,7 @@ std::string RedisMgr::acquireLock(
     Defer defer([&connect, this]() {});
 
     return DistLock::Inst().acquireLock(
-        connect, lockName, lockTimeout, acquireTimeout);
+        connect, lockName, lockTimeout, acquireTimeout, fence);
 }
 
 bool RedisMgr::releaseLock(
@@ -370,77 +585,159 @@ bool RedisMgr::releaseLock(
     return DistLock::Inst().releaseLock(connect, lockName, identifier);
 }
 
-void RedisMgr::IncreaseCount(std::string server_name)
+bool RedisMgr::renewLock(
+    const std::string& lockName, const std::string& identifier, int lockTimeout)
 {
-    auto lock_key   = LOCK_COUNT;
-    auto identifier = RedisMgr::GetInstance()->acquireLock(
-        lock_key, LOCK_TIME_OUT, ACQUIRE_TIME_OUT);
-    // 利用defer解锁
-    Defer defer2([this, identifier, lock_key]() {
-        RedisMgr::GetInstance()->releaseLock(lock_key, identifier);
-    });
+    if (identifier.empty())
+    {
+        return false;
+    }
+    auto connect = con_pool_->get();
+    if (connect == nullptr)
+    {
+        return false;
+    }
 
-    // 将登录数量增加
-    auto rd_res = RedisMgr::GetInstance()->HGet(LOGIN_COUNT, server_name);
-    int  count  = 0;
-    if (!rd_res.empty())
+    return DistLock::Inst().renewLock(
+        connect, lockName, identifier, lockTimeout);
+}
+
+bool RedisMgr::ClaimLogin(const std::string& uid_str,
+    const std::string& server_name, const std::string& session_id,
+    std::string& prev_server, std::string& prev_session)
+{
+    auto connect = con_pool_->get();
+    if (connect == nullptr)
+    {
+        return false;
+    }
+
+    std::string ipkey       = USERIPPREFIX + uid_str;
+    std::string session_key = USER_SESSION_PREFIX + uid_str;
+    auto        reply       = kClaimLoginScript.exec(
+        connect, {ipkey, session_key}, {server_name, session_id});
+    if (reply == nullptr || reply->type != REDIS_REPLY_ARRAY ||
+        reply->elements != 2)
+    {
+        std::cout << "Execut command [ ClaimLogin " << uid_str << " ] failure"
+                  << std::endl;
+        return false;
+    }
+
+    prev_server.assign(reply->element[0]->str, reply->element[0]->len);
+    prev_session.assign(reply->element[1]->str, reply->element[1]->len);
+    return true;
+}
+
+bool RedisMgr::ReleaseLogin(
+    const std::string& uid_str, const std::string& session_id)
+{
+    auto connect = con_pool_->get();
+    if (connect == nullptr)
     {
-        count = std::stoi(rd_res);
+        return false;
     }
 
-    count++;
-    auto count_str = std::to_string(count);
-    RedisMgr::GetInstance()->HSet(LOGIN_COUNT, server_name, count_str);
+    std::string ipkey       = USERIPPREFIX + uid_str;
+    std::string session_key = USER_SESSION_PREFIX + uid_str;
+    auto        reply       = kReleaseLoginScript.exec(
+        connect, {ipkey, session_key}, {session_id});
+    return reply != nullptr && reply->type == REDIS_REPLY_INTEGER &&
+           reply->integer == 1;
 }
 
-void RedisMgr::DecreaseCount(std::string server_name)
+int RedisMgr::VerifyToken(const std::string& uid_str, const std::string& token)
 {
-    auto lock_key   = LOCK_COUNT;
-    auto identifier = RedisMgr::GetInstance()->acquireLock(
-        lock_key, LOCK_TIME_OUT, ACQUIRE_TIME_OUT);
-    // 利用defer解锁
-    Defer defer2([this, identifier, lock_key]() {
-        RedisMgr::GetInstance()->releaseLock(lock_key, identifier);
-    });
-
-    // 将登录数量减少
-    auto rd_res = RedisMgr::GetInstance()->HGet(LOGIN_COUNT, server_name);
-    int  count  = 0;
-    if (!rd_res.empty())
-    {
-        count = std::stoi(rd_res);
-        if (count > 0)
+    // 开启缓存时 token 先和本地内存比较
+    std::string token_key = USERTOKENPREFIX + uid_str;
+    bool        cacheable = cache_ && cache_->Cacheable(token_key);
+    uint64_t    gen       = 0;
+    if (cacheable)
+    {
+        std::string value;
+        if (cache_->Get(token_key, value) && value == token)
         {
-            count--;
+            return 1;
         }
+        // 未命中或不匹配时只执行一次脚本, 以 redis 中的值为准
+        // 重新登录写入新 token 后, 失效通知可能晚于客户端连接到达
+        gen = cache_->Generation(token_key);
     }
 
-    auto count_str = std::to_string(count);
-    RedisMgr::GetInstance()->HSet(LOGIN_COUNT, server_name, count_str);
+    auto connect = con_pool_->get();
+    if (connect == nullptr)
+    {
+        return -1;
+    }
+
+    auto reply = kVerifyTokenScript.exec(connect, {token_key}, {token});
+    if (reply == nullptr || reply->type != REDIS_REPLY_INTEGER)
+    {
+        std::cout << "Execut command [ VerifyToken " << uid_str << " ] failure"
+                  << std::endl;
+        return -1;
+    }
+    // 匹配说明 redis 中的值就是 token, 直接回填缓存
+    if (cacheable && reply->integer == 1)
+    {
+        cache_->Put(token_key, token, gen);
+    }
+    return (int)reply->integer;
+}
+
+void RedisMgr::GetCacheStats(uint64_t& hits, uint64_t& misses)
+{
+    hits   = cache_ ? cache_->Hits() : 0;
+    misses = cache_ ? cache_->Misses() : 0;
+}
+
+int64_t RedisMgr::IncreaseCount(std::string server_name, int64_t delta)
+{
+    auto connect = con_pool_->get();
+    if (connect == nullptr)
+    {
+        return -1;
+    }
+
+    // 每个服务器只写自己的字段, 增量更新不再需要分布式锁
+    auto reply = kIncrCountScript.exec(connect, {LOGIN_COUNT},
+        {server_name, std::to_string(delta), LOGIN_COUNT_CHANNEL});
+    if (reply == nullptr || reply->type != REDIS_REPLY_INTEGER)
+    {
+        std::cout << "Execut command [ HINCRBY " << LOGIN_COUNT << " "
+                  << server_name << " " << delta << " ] failure" << std::endl;
+        return -1;
+    }
+    return reply->integer;
 }
 
-void RedisMgr::InitCount(std::string server_name)
+int64_t RedisMgr::DecreaseCount(std::string server_name, int64_t delta)
 {
-    auto lock_key   = LOCK_COUNT;
-    auto identifier = RedisMgr::GetInstance()->acquireLock(
-        lock_key, LOCK_TIME_OUT, ACQUIRE_TIME_OUT);
-    // 利用defer解锁
-    Defer defer2([this, identifier, lock_key]() {
-        RedisMgr::GetInstance()->releaseLock(lock_key, identifier);
-    });
-
-    RedisMgr::GetInstance()->HSet(LOGIN_COUNT, server_name, "0");
+    return IncreaseCount(server_name, -delta);
+}
+
+void RedisMgr::SetCount(std::string server_name, int64_t count)
+{
+    auto connect = con_pool_->get();
+    if (connect == nullptr)
+    {
+        return;
+    }
+
+    kSetCountScript.exec(connect, {LOGIN_COUNT},
+        {server_name, std::to_string(count), LOGIN_COUNT_CHANNEL});
 }
 
+void RedisMgr::InitCount(std::string server_name) { SetCount(server_name, 0); }
+
 void RedisMgr::DelCount(std::string server_name)
 {
-    auto lock_key   = LOCK_COUNT;
-    auto identifier = RedisMgr::GetInstance()->acquireLock(
-        lock_key, LOCK_TIME_OUT, ACQUIRE_TIME_OUT);
-    // 利用defer解锁
-    Defer defer2([this, identifier, lock_key]() {
-        RedisMgr::GetInstance()->releaseLock(lock_key, identifier);
-    });
-
-    RedisMgr::GetInstance()->HDel(LOGIN_COUNT, server_name);
+    auto connect = con_pool_->get();
+    if (connect == nullptr)
+    {
+        return;
+    }
+
+    kDelCountScript.exec(
+        connect, {LOGIN_COUNT}, {server_name, LOGIN_COUNT_CHANNEL});
 }
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "RedisCache.h"
 #include "Singleton.h"
 #include "redis.h"
 
@@ -12,6 +13,9 @@ class RedisMgr : public Singleton<RedisMgr>,
     ~RedisMgr();
     bool        Get(const std::string& key, std::string& value);
     bool        Set(const std::string& key, const std::string& value);
+    // 一次MGET批量读取, found[i]表示keys[i]是否存在
+    bool MGet(const std::vector<std::string>& keys,
+        std::vector<std::string>& values, std::vector<bool>& found);
     bool        LPush(const std::string& key, const std::string& value);
     bool        LPop(const std::string& key, std::string& value);
     bool        RPush(const std::string& key, const std::string& value);
@@ -22,19 +26,44 @@ class RedisMgr : public Singleton<RedisMgr>,
     bool        HDel(const std::string& key, const std::string& field);
     bool        Del(const std::string& key);
     bool        ExistsKey(const std::string& key);
+    // 追加到stream, 成功返回记录id, 失败返回空串
+    std::string XAdd(
+        const std::string& stream, const std::vector<std::string>& fields);
 
-    std::string acquireLock(
-        const std::string& lockName, int lockTimeout, int acquireTimeout);
+    // 滑动窗口计数: 未超过 limit 时记一次返回 1, 超过返回 0, 出错返回 -1
+    int SlidingWindow(const std::string& key, int64_t window_ms, int64_t limit);
+
+    std::string acquireLock(const std::string& lockName, int lockTimeout,
+        int acquireTimeout, int64_t* fence = nullptr);
 
     bool releaseLock(
         const std::string& lockName, const std::string& identifier);
 
-    void IncreaseCount(std::string server_name);
-    void DecreaseCount(std::string server_name);
-    void InitCount(std::string server_name);
-    void DelCount(std::string server_name);
+    bool renewLock(const std::string& lockName, const std::string& identifier,
+        int lockTimeout);
+
+    // 原子地登记用户的登录服务器和session, 返回之前的登录信息
+    bool ClaimLogin(const std::string& uid_str, const std::string& server_name,
+        const std::string& session_id, std::string& prev_server,
+        std::string& prev_session);
+    // 只有 session 仍是当前登录的 session 时才清除登录信息
+    bool ReleaseLogin(
+        const std::string& uid_str, const std::string& session_id);
+    // 校验登录token, 1 匹配, 0 不匹配, -1 不存在或出错
+    int VerifyToken(const std::string& uid_str, const std::string& token);
+
+    // 本地缓存的命中与未命中次数, 未开启缓存时均为 0
+    void GetCacheStats(uint64_t& hits, uint64_t& misses);
+
+    // 增量修改登录数并发布到 LOGIN_COUNT_CHANNEL, 返回修改后的值, 失败返回 -1
+    int64_t IncreaseCount(std::string server_name, int64_t delta = 1);
+    int64_t DecreaseCount(std::string server_name, int64_t delta = 1);
+    void    SetCount(std::string server_name, int64_t count);
+    void    InitCount(std::string server_name);
+    void    DelCount(std::string server_name);
 
   private:
     RedisMgr();
-    std::unique_ptr<RedisPool> con_pool_;
+    std::unique_ptr<RedisPool>  con_pool_;
+    std::unique_ptr<RedisCache> cache_;
 };
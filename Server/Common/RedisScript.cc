@@ -0,0 +1,72 @@
+#include "RedisScript.h"
+
+#include <iostream>
+
+RedisScript::RedisScript(const std::string& source) : source_(source)
+{
+    registry().push_back(this);
+}
+
+std::vector<RedisScript*>& RedisScript::registry()
+{
+    // 脚本都是静态对象, 放在函数内避免静态初始化顺序问题
+    static std::vector<RedisScript*> scripts;
+    return scripts;
+}
+
+void RedisScript::LoadAll(IRedis::ptr connect)
+{
+    if (connect == nullptr)
+    {
+        return;
+    }
+    for (auto script : registry())
+    {
+        script->load(connect);
+    }
+}
+
+std::string RedisScript::getSha()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return sha_;
+}
+
+bool RedisScript::load(IRedis::ptr connect)
+{
+    auto reply = connect->exec("SCRIPT", "LOAD", source_);
+    if (reply == nullptr || reply->type != REDIS_REPLY_STRING)
+    {
+        std::cout << "Execut command [ SCRIPT LOAD ] failure" << std::endl;
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    sha_.assign(reply->str, reply->len);
+    return true;
+}
+
+ReplyPtr RedisScript::exec(IRedis::ptr connect,
+    const std::vector<std::string>& keys, const std::vector<std::string>& args)
+{
+    auto sha = getSha();
+    if (sha.empty() && load(connect))
+    {
+        sha = getSha();
+    }
+
+    if (sha.empty())
+    {
+        return connect->exec("EVAL", source_, keys.size(), keys, args);
+    }
+
+    auto reply = connect->exec("EVALSHA", sha, keys.size(), keys, args);
+    if (reply != nullptr ||
+        connect->getLastError().compare(0, 8, "NOSCRIPT") != 0)
+    {
+        return reply;
+    }
+
+    // 服务端脚本缓存被清空, 用 EVAL 执行, 同时 redis 会重新缓存该脚本
+    return connect->exec("EVAL", source_, keys.size(), keys, args);
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "redis.h"
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+// 服务端 lua 脚本
+// 脚本只在首次使用或启动时 SCRIPT LOAD 一次, 之后通过 EVALSHA 调用
+// redis 重启或执行 SCRIPT FLUSH 后会返回 NOSCRIPT, 此时退回 EVAL 并重新缓存
+class RedisScript
+{
+  public:
+    explicit RedisScript(const std::string& source);
+
+    ReplyPtr exec(IRedis::ptr connect, const std::vector<std::string>& keys,
+        const std::vector<std::string>& args);
+
+    // 启动时预加载全部已注册的脚本
+    static void LoadAll(IRedis::ptr connect);
+
+  private:
+    bool        load(IRedis::ptr connect);
+    std::string getSha();
+
+    static std::vector<RedisScript*>& registry();
+
+    std::string source_;
+    std::mutex  mutex_;
+    std::string sha_;
+};
@@ -0,0 +1,181 @@
+#include "RedisSubscriber.h"
+
+#include <chrono>
+#include <iostream>
+
+RedisSubscriber::RedisSubscriber(
+    const std::string& host, int32_t port, const std::string& passwd)
+    : host_(host),
+      port_(port),
+      passwd_(passwd),
+      stopped_(true),
+      connected_(false),
+      dirty_(false)
+{}
+
+RedisSubscriber::~RedisSubscriber() { Stop(); }
+
+void RedisSubscriber::Subscribe(const std::string& channel, MessageCallback cb)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    channels_[channel] = cb;
+    dirty_             = true;
+}
+
+void RedisSubscriber::PSubscribe(const std::string& pattern, MessageCallback cb)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    patterns_[pattern] = cb;
+    dirty_             = true;
+}
+
+void RedisSubscriber::OnConnected(ConnectCallback cb)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    connect_cb_ = cb;
+}
+
+void RedisSubscriber::Start()
+{
+    if (!stopped_)
+    {
+        return;
+    }
+    stopped_ = false;
+    thread_  = std::thread(&RedisSubscriber::Run, this);
+}
+
+void RedisSubscriber::Stop()
+{
+    stopped_ = true;
+    if (thread_.joinable())
+    {
+        thread_.join();
+    }
+    connected_ = false;
+}
+
+bool RedisSubscriber::Connect()
+{
+    redis_.reset(new Redis(host_, port_, passwd_));
+    if (!redis_->connect())
+    {
+        redis_.reset();
+        return false;
+    }
+
+    // 重连后需要重新订阅全部频道
+    return SendPending();
+}
+
+bool RedisSubscriber::SendPending()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    // 重复订阅是幂等的, 直接全部重发
+    for (auto& i : channels_)
+    {
+        redis_->appendCmd({"SUBSCRIBE", i.first});
+    }
+    for (auto& i : patterns_)
+    {
+        redis_->appendCmd({"PSUBSCRIBE", i.first});
+    }
+    dirty_ = false;
+    return redis_->flush();
+}
+
+void RedisSubscriber::Dispatch(const ReplyPtr& reply)
+{
+    if (reply->type != REDIS_REPLY_ARRAY || reply->elements < 3)
+    {
+        return;
+    }
+    std::string kind(reply->element[0]->str, reply->element[0]->len);
+
+    MessageCallback cb;
+    std::string     channel;
+    std::string     message;
+    if (kind == "message")
+    {
+        channel.assign(reply->element[1]->str, reply->element[1]->len);
+        message.assign(reply->element[2]->str, reply->element[2]->len);
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto                        it = channels_.find(channel);
+        if (it != channels_.end())
+        {
+            cb = it->second;
+        }
+    }
+    else if (kind == "pmessage" && reply->elements >= 4)
+    {
+        std::string pattern(reply->element[1]->str, reply->element[1]->len);
+        channel.assign(reply->element[2]->str, reply->element[2]->len);
+        message.assign(reply->element[3]->str, reply->element[3]->len);
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto                        it = patterns_.find(pattern);
+        if (it != patterns_.end())
+        {
+            cb = it->second;
+        }
+    }
+
+    if (cb)
+    {
+        cb(channel, message);
+    }
+}
+
+void RedisSubscriber::Run()
+{
+    int retry_ms = 100;
+    while (!stopped_)
+    {
+        if (!redis_)
+        {
+            if (!Connect())
+            {
+                connected_ = false;
+                std::cout << "RedisSubscriber connect failed: (" << host_ << ":"
+                          << port_ << ")" << std::endl;
+                std::this_thread::sleep_for(
+                    std::chrono::milliseconds(retry_ms));
+                retry_ms = std::min(retry_ms * 2, 5000);
+                continue;
+            }
+            connected_ = true;
+            retry_ms   = 100;
+
+            ConnectCallback cb;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                cb = connect_cb_;
+            }
+            if (cb)
+            {
+                cb();
+            }
+        }
+
+        if (dirty_ && !SendPending())
+        {
+            connected_ = false;
+            redis_.reset();
+            continue;
+        }
+
+        // 超时返回以便检查停止标记和新增订阅
+        ReplyPtr reply;
+        int      rt = redis_->waitReply(reply, 200);
+        if (rt < 0)
+        {
+            connected_ = false;
+            redis_.reset();
+            continue;
+        }
+        if (rt > 0)
+        {
+            Dispatch(reply);
+        }
+    }
+    redis_.reset();
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "redis.h"
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// 独占一条 redis 连接的订阅者, 在后台线程中接收 pub/sub 消息
+class RedisSubscriber
+{
+  public:
+    typedef std::function<void(
+        const std::string& channel, const std::string& message)>
+        MessageCallback;
+    typedef std::function<void()> ConnectCallback;
+
+    RedisSubscriber(
+        const std::string& host, int32_t port, const std::string& passwd);
+    ~RedisSubscriber();
+
+    void Subscribe(const std::string& channel, MessageCallback cb);
+    void PSubscribe(const std::string& pattern, MessageCallback cb);
+    // 每次连接并订阅成功后在订阅线程中调用, 断线期间的消息已经丢失
+    void OnConnected(ConnectCallback cb);
+
+    void Start();
+    void Stop();
+
+    // 连接正常且订阅已生效
+    bool IsConnected() const { return connected_; }
+
+  private:
+    void Run();
+    bool Connect();
+    bool SendPending();
+    void Dispatch(const ReplyPtr& reply);
+
+    std::string host_;
+    int32_t     port_;
+    std::string passwd_;
+
+    std::unique_ptr<Redis> redis_;
+    std::thread            thread_;
+    std::atomic<bool>      stopped_;
+    std::atomic<bool>      connected_;
+
+    std::mutex                             mutex_;
+    std::map<std::string, MessageCallback> channels_;
+    std::map<std::string, MessageCallback> patterns_;
+    ConnectCallback                        connect_cb_;
+    // 新增的订阅需要在订阅线程中发送
+    std::atomic<bool> dirty_;
+};
@@ -0,0 +1,134 @@
+#include "TokenSigner.h"
+#include "ConfigMgr.h"
+#include "Logger.h"
+
+#include <chrono>
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include <openssl/rand.h>
+#include <vector>
+
+namespace
+{
+const char* kVersion = "v1";
+
+int64_t NowSec()
+{
+    return std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+std::string ToHex(const unsigned char* data, size_t len)
+{
+    static const char* digits = "0123456789abcdef";
+    std::string        hex;
+    hex.reserve(len * 2);
+    for (size_t i = 0; i < len; ++i)
+    {
+        hex += digits[data[i] >> 4];
+        hex += digits[data[i] & 0x0F];
+    }
+    return hex;
+}
+
+std::vector<std::string> Split(const std::string& str, char sep)
+{
+    std::vector<std::string> parts;
+    size_t                   begin = 0;
+    for (;;)
+    {
+        size_t pos = str.find(sep, begin);
+        parts.push_back(str.substr(begin, pos - begin));
+        if (pos == std::string::npos)
+        {
+            return parts;
+        }
+        begin = pos + 1;
+    }
+}
+}  // namespace
+
+TokenSigner::TokenSigner()
+{
+    auto& cfg   = ConfigMgr::Inst();
+    auto  ttl   = cfg["Token"]["TTL"];
+    secret_     = cfg["Token"]["Secret"];
+    old_secret_ = cfg["Token"]["OldSecret"];
+    ttl_        = ttl.empty() ? 300 : std::stoll(ttl);
+    enabled_    = cfg["Token"]["Mode"] == "signed" && !secret_.empty();
+    if (cfg["Token"]["Mode"] == "signed" && secret_.empty())
+    {
+        LOG_ERROR("Token Mode is signed but Secret is empty, use redis token");
+    }
+}
+
+bool TokenSigner::IsSigned(const std::string& token) const
+{
+    return token.compare(0, 3, std::string(kVersion) + ".") == 0;
+}
+
+std::string TokenSigner::sign(
+    const std::string& secret, const std::string& payload)
+{
+    unsigned char md[EVP_MAX_MD_SIZE];
+    unsigned int  md_len = 0;
+    HMAC(EVP_sha256(), secret.data(), (int)secret.size(),
+        (const unsigned char*)payload.data(), payload.size(), md, &md_len);
+    return ToHex(md, md_len);
+}
+
+std::string TokenSigner::Mint(int uid, const std::string& server)
+{
+    unsigned char nonce[8];
+    if (RAND_bytes(nonce, sizeof(nonce)) != 1)
+    {
+        LOG_ERROR("Mint token failed, RAND_bytes error, uid: {}", uid);
+        return "";
+    }
+
+    std::string payload = std::string(kVersion) + "." + std::to_string(uid) +
+                          "." + server + "." +
+                          std::to_string(NowSec() + ttl_) + "." +
+                          ToHex(nonce, sizeof(nonce));
+    return payload + "." + sign(secret_, payload);
+}
+
+bool TokenSigner::Verify(
+    const std::string& token, int uid, const std::string& server)
+{
+    // 服务器名中不能含有 '.', 否则段数不对直接判为无效
+    auto parts = Split(token, '.');
+    if (parts.size() != 6 || parts[0] != kVersion)
+    {
+        return false;
+    }
+
+    std::string payload = token.substr(0, token.rfind('.'));
+    const auto& sig     = parts[5];
+    auto        equal   = [&sig](const std::string& expect) {
+        return expect.size() == sig.size() &&
+               CRYPTO_memcmp(expect.data(), sig.data(), sig.size()) == 0;
+    };
+    if (!equal(sign(secret_, payload)) &&
+        (old_secret_.empty() || !equal(sign(old_secret_, payload))))
+    {
+        return false;
+    }
+
+    int64_t expiry = 0;
+    try
+    {
+        if (std::stoi(parts[1]) != uid)
+        {
+            return false;
+        }
+        expiry = std::stoll(parts[3]);
+    }
+    catch (std::exception&)
+    {
+        return false;
+    }
+    return parts[2] == server && expiry >= NowSec();
+}
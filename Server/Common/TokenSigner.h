@@ -0,0 +1,37 @@
+#pragma once
+
+#include "Singleton.h"
+
+#include <cstdint>
+#include <string>
+
+// 无状态登录 token
+// 格式为 v1.<uid>.<server>.<expiry>.<nonce>.<sig>
+// sig 为前面各段的 HMAC-SHA256, 由 StatusServer 签发, ChatServer 本地校验
+// 校验不访问 redis; 与 redis token 一样在有效期内可重复使用
+// 以便客户端断线重连或重试时登录同一台服务器, 重放窗口由 ttl 限定
+class TokenSigner : public Singleton<TokenSigner>
+{
+    friend class Singleton<TokenSigner>;
+
+  public:
+    // [Token] Mode = signed 时启用, 否则仍使用 redis 中的随机 token
+    bool Enabled() const { return enabled_; }
+    bool IsSigned(const std::string& token) const;
+
+    // 生成随机数失败时返回空串
+    std::string Mint(int uid, const std::string& server);
+    // 校验签名、uid、服务器与有效期
+    bool Verify(const std::string& token, int uid, const std::string& server);
+
+  private:
+    TokenSigner();
+
+    std::string sign(const std::string& secret, const std::string& payload);
+
+    bool        enabled_;
+    std::string secret_;
+    // 轮换密钥期间旧密钥签发的 token 仍然有效
+    std::string old_secret_;
+    int64_t     ttl_;
+};
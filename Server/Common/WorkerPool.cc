@@ -0,0 +1,95 @@
+#include "WorkerPool.h"
+
+WorkerPool::WorkerPool(size_t threads, size_t max_queue)
+    : max_queue_(max_queue), stopped_(false)
+{
+    for (size_t i = 0; i < threads; ++i)
+    {
+        threads_.emplace_back(&WorkerPool::Run, this);
+    }
+}
+
+WorkerPool::~WorkerPool() { Stop(); }
+
+bool WorkerPool::Post(Task task)
+{
+    return Post(task, std::chrono::milliseconds(0), nullptr);
+}
+
+bool WorkerPool::Post(
+    Task task, std::chrono::milliseconds deadline, Task on_expired)
+{
+    Item item;
+    item.task       = std::move(task);
+    item.on_expired = std::move(on_expired);
+    // 0 表示不限制排队时间
+    item.deadline = deadline.count() > 0
+                        ? std::chrono::steady_clock::now() + deadline
+                        : std::chrono::steady_clock::time_point::max();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stopped_ || queue_.size() >= max_queue_)
+    {
+        return false;
+    }
+    queue_.emplace_back(std::move(item));
+    cond_.notify_one();
+    return true;
+}
+
+void WorkerPool::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopped_)
+        {
+            return;
+        }
+        stopped_ = true;
+    }
+    cond_.notify_all();
+    for (auto& t : threads_)
+    {
+        if (t.joinable())
+        {
+            t.join();
+        }
+    }
+}
+
+size_t WorkerPool::QueueSize()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return queue_.size();
+}
+
+void WorkerPool::Run()
+{
+    for (;;)
+    {
+        Item item;
+        bool expired;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cond_.wait(lock, [this] { return stopped_ || !queue_.empty(); });
+            if (queue_.empty())
+            {
+                return;
+            }
+            item = std::move(queue_.front());
+            queue_.pop_front();
+            // 停止后剩余的任务按超时处理, 保证调用方总能收到回调
+            expired = stopped_;
+        }
+
+        expired = expired || std::chrono::steady_clock::now() > item.deadline;
+        if (!expired)
+        {
+            item.task();
+        }
+        else if (item.on_expired)
+        {
+            item.on_expired();
+        }
+    }
+}
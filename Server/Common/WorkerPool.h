@@ -0,0 +1,46 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// 有界任务队列 + 固定线程数的工作池
+// 队列满时 Post 直接失败, 由调用方决定如何降级
+// 任务可以带截止时间, 排队超时的任务不再执行而是回调 on_expired
+// 截止时间只约束排队时间, 任务开始执行后不再检查, 执行耗时由任务内部的
+// 下游超时限制 (mysql 连接的读写超时, grpc 调用的 deadline)
+class WorkerPool
+{
+  public:
+    typedef std::function<void()> Task;
+
+    WorkerPool(size_t threads, size_t max_queue);
+    ~WorkerPool();
+
+    bool Post(Task task);
+    bool Post(Task task, std::chrono::milliseconds deadline, Task on_expired);
+
+    void   Stop();
+    size_t QueueSize();
+
+  private:
+    struct Item
+    {
+        Task                                  task;
+        Task                                  on_expired;
+        std::chrono::steady_clock::time_point deadline;
+    };
+
+    void Run();
+
+    size_t                   max_queue_;
+    std::deque<Item>         queue_;
+    std::mutex               mutex_;
+    std::condition_variable  cond_;
+    bool                     stopped_;
+    std::vector<std::thread> threads_;
+};
@@ -3,18 +3,19 @@
 
 enum ErrorCodes
 {
-    Success        = 0,
-    Error_Json     = 1001,  // Json解析错误
-    RPCFailed      = 1002,  // RPC请求错误
-    VarifyExpired  = 1003,  // 验证码过期
-    VarifyCodeErr  = 1004,  // 验证码错误
-    UserExist      = 1005,  // 用户已经存在
-    PasswdErr      = 1006,  // 密码错误
-    EmailNotMatch  = 1007,  // 邮箱不匹配
-    PasswdUpFailed = 1008,  // 更新密码失败
-    PasswdInvalid  = 1009,  // 密码更新失败
-    TokenInvalid   = 1010,  // Token失效
-    UidInvalid     = 1011,  // uid无效
+    Success         = 0,
+    Error_Json      = 1001,  // Json解析错误
+    RPCFailed       = 1002,  // RPC请求错误
+    VarifyExpired   = 1003,  // 验证码过期
+    VarifyCodeErr   = 1004,  // 验证码错误
+    UserExist       = 1005,  // 用户已经存在
+    PasswdErr       = 1006,  // 密码错误
+    EmailNotMatch   = 1007,  // 邮箱不匹配
+    PasswdUpFailed  = 1008,  // 更新密码失败
+    PasswdInvalid   = 1009,  // 密码更新失败
+    TokenInvalid    = 1010,  // Token失效
+    UidInvalid      = 1011,  // uid无效
+    TooManyRequests = 1012,  // 请求过于频繁
 };
 
 // Defer类
@@ -40,6 +41,8 @@ class Defer
 #define HEAD_DATA_LEN 2
 #define MAX_RECVQUE 10000
 #define MAX_SENDQUE 1000
+// 好友列表每页条数, 保证单页回包不超过MAX_LENGTH
+#define FRIEND_PAGE_SIZE 10
 
 enum MSG_IDS
 {
@@ -59,18 +62,28 @@ enum MSG_IDS
     ID_NOTIFY_OFF_LINE_REQ      = 1021,  // 通知用户下线
     ID_HEART_BEAT_REQ           = 1023,  // 心跳请求
     ID_HEARTBEAT_RSP            = 1024,  // 心跳回复
+    ID_FRIEND_LIST_REQ          = 1025,  // 分页拉取好友列表请求
+    ID_FRIEND_LIST_RSP          = 1026,  // 分页拉取好友列表回复
+    ID_FRIEND_SYNC_REQ          = 1027,  // 好友增量同步请求
+    ID_FRIEND_SYNC_RSP          = 1028,  // 好友增量同步回复
+    ID_NOTIFY_MIGRATE_REQ       = 1029,  // 通知用户迁移到其他服务器
 };
 
 #define CODEPREFIX "code_"
 #define USERIPPREFIX "uip_"
 #define USERTOKENPREFIX "utoken_"
 #define IPCOUNTPREFIX "ipcount_"
+#define ACCOUNTCOUNTPREFIX "acctcount_"
 #define USER_BASE_INFO "ubaseinfo_"
 #define LOGIN_COUNT "logincount"
+#define LOGIN_COUNT_CHANNEL "logincount_ev"
 #define NAME_INFO "nameinfo_"
 #define LOCK_PREFIX "lock_"
 #define USER_SESSION_PREFIX "usession_"
-#define LOCK_COUNT "lockcount"
+#define LOCK_FENCE "lockfence"
+#define LOCK_EVENT_PREFIX "lockev:"
+#define FRIEND_APPLY_STREAM "friendapply_stream"
+#define FRIEND_APPLY_GROUP "friendapply_writer"
 
 // 分布式锁的持有时间
 #define LOCK_TIME_OUT 10
@@ -1,4 +1,5 @@
 #pragma once
+#include <cstdint>
 #include <string>
 struct UserInfo
 {
@@ -45,3 +46,22 @@ struct ApplyInfo
     int         sex_;
     int         status_;
 };
+
+// 好友变更日志类型
+enum FriendChangeOp
+{
+    FRIEND_CHANGE_ADD        = 1,  // 新增好友
+    FRIEND_CHANGE_DEL        = 2,  // 删除好友
+    FRIEND_CHANGE_APPLY      = 3,  // 收到好友申请
+    FRIEND_CHANGE_APPLY_AUTH = 4,  // 好友申请状态变更
+};
+
+struct FriendChange
+{
+    FriendChange() : version_(0), op_(0), status_(0) {}
+
+    int64_t  version_;
+    int      op_;
+    int      status_;
+    UserInfo peer_;  // 变更涉及的对方用户, back_为备注
+};
@@ -98,9 +98,15 @@ MySQL::MySQL(const std::string& host, const int32_t port,
       m_dbname(dbname),
       m_timeout(timeout),
       m_lastUsedTime(0),
-      m_hasError(false)
+      m_lastCheckoutTime(0),
+      m_hasError(false),
+      m_stmtCacheSize(32),
+      m_stmtHits(nullptr),
+      m_stmtPrepares(nullptr)
 {}
 
+MySQL::~MySQL() { clearStmtCache(); }
+
 bool MySQL::connect()
 {
     if (m_mysql && !m_hasError)
@@ -108,6 +114,9 @@ bool MySQL::connect()
         return true;
     }
 
+    // 预处理语句绑定在旧连接上, 重连后全部失效
+    clearStmtCache();
+
     MYSQL* m =
         mysql_init(m_host, m_port, m_user, m_passwd, m_dbname, m_timeout);
     if (!m)
@@ -125,6 +134,74 @@ IStmt::ptr MySQL::prepare(const std::string& sql)
     return MySQLStmt::Create(shared_from_this(), sql);
 }
 
+MYSQL_STMT* MySQL::acquireStmt(const std::string& sql)
+{
+    auto it = m_stmtCache.find(sql);
+    if (it != m_stmtCache.end())
+    {
+        MYSQL_STMT* st = it->second->second;
+        m_stmtLru.erase(it->second);
+        m_stmtCache.erase(it);
+        m_stmtOut.insert(st);
+        if (m_stmtHits)
+        {
+            (*m_stmtHits)++;
+        }
+        return st;
+    }
+
+    if (m_stmtPrepares)
+    {
+        (*m_stmtPrepares)++;
+    }
+    auto st = mysql_stmt_init(m_mysql.get());
+    if (!st)
+    {
+        return nullptr;
+    }
+    if (mysql_stmt_prepare(st, sql.c_str(), sql.size()))
+    {
+        std::cout << "stmt=" << sql << " errno=" << mysql_stmt_errno(st)
+                  << " errstr=" << mysql_stmt_error(st);
+        mysql_stmt_close(st);
+        return nullptr;
+    }
+    m_stmtOut.insert(st);
+    return st;
+}
+
+void MySQL::releaseStmt(const std::string& sql, MYSQL_STMT* stmt)
+{
+    // 不在 m_stmtOut 中说明连接已经重建, 语句直接关闭
+    if (m_stmtOut.erase(stmt) == 0 || m_stmtCacheSize == 0 ||
+        m_stmtCache.count(sql) || mysql_stmt_reset(stmt))
+    {
+        mysql_stmt_close(stmt);
+        return;
+    }
+
+    m_stmtLru.emplace_front(sql, stmt);
+    m_stmtCache[sql] = m_stmtLru.begin();
+    if (m_stmtCache.size() > m_stmtCacheSize)
+    {
+        auto& last = m_stmtLru.back();
+        mysql_stmt_close(last.second);
+        m_stmtCache.erase(last.first);
+        m_stmtLru.pop_back();
+    }
+}
+
+void MySQL::clearStmtCache()
+{
+    for (auto& i : m_stmtLru)
+    {
+        mysql_stmt_close(i.second);
+    }
+    m_stmtLru.clear();
+    m_stmtCache.clear();
+    m_stmtOut.clear();
+}
+
 ITransaction::ptr MySQL::openTransaction(bool auto_commit)
 {
     return MySQLTransaction::Create(shared_from_this(), auto_commit);
@@ -132,9 +209,9 @@ ITransaction::ptr MySQL::openTransaction(bool auto_commit)
 
 int64_t MySQL::getLastInsertId() { return mysql_insert_id(m_mysql.get()); }
 
-bool MySQL::isNeedCheck()
+bool MySQL::isNeedCheck(int sec)
 {
-    if ((time(0) - m_lastUsedTime) < 5 && !m_hasError)
+    if ((time(0) - m_lastUsedTime) < sec && !m_hasError)
     {
         return false;
     }
@@ -261,20 +338,13 @@ inline std::shared_ptr<T> protected_make_shared(Args&&... args)
 
 MySQLStmt::ptr MySQLStmt::Create(MySQL::ptr db, const std::string& stmt)
 {
-    auto st = mysql_stmt_init(db->getRaw().get());
+    auto st = db->acquireStmt(stmt);
     if (!st)
     {
         return nullptr;
     }
-    if (mysql_stmt_prepare(st, stmt.c_str(), stmt.size()))
-    {
-        std::cout << "stmt=" << stmt << " errno=" << mysql_stmt_errno(st)
-                  << " errstr=" << mysql_stmt_error(st);
-        mysql_stmt_close(st);
-        return nullptr;
-    }
     int            count = mysql_stmt_param_count(st);
-    MySQLStmt::ptr rt    = protected_make_shared<MySQLStmt>(db, st);
+    MySQLStmt::ptr rt    = protected_make_shared<MySQLStmt>(db, st, stmt);
     rt->m_binds.resize(count);
     for (int i = 0; i < count; ++i)
     {
@@ -283,15 +353,16 @@ MySQLStmt::ptr MySQLStmt::Create(MySQL::ptr db, const std::string& stmt)
     return rt;
 }
 
-MySQLStmt::MySQLStmt(MySQL::ptr db, MYSQL_STMT* stmt)
-    : m_mysql(db), m_stmt(stmt)
+MySQLStmt::MySQLStmt(MySQL::ptr db, MYSQL_STMT* stmt, const std::string& sql)
+    : m_mysql(db), m_stmt(stmt), m_sql(sql)
 {}
 
 MySQLStmt::~MySQLStmt()
 {
     if (m_stmt)
     {
-        mysql_stmt_close(m_stmt);
+        // 归还到连接的缓存, 下次执行同样的 sql 时省去一次 prepare
+        m_mysql->releaseStmt(m_sql, m_stmt);
     }
 
     for (auto& i : m_binds)
@@ -591,6 +662,21 @@ int MySQLStmt::execute()
 
 int64_t MySQLStmt::getLastInsertId() { return mysql_stmt_insert_id(m_stmt); }
 
+int MySQLStmt::executeStore()
+{
+    if (!m_binds.empty() && mysql_stmt_bind_param(m_stmt, &m_binds[0]))
+    {
+        return -1;
+    }
+    if (mysql_stmt_execute(m_stmt) || mysql_stmt_store_result(m_stmt))
+    {
+        return -1;
+    }
+    return 0;
+}
+
+void MySQLStmt::freeResult() { mysql_stmt_free_result(m_stmt); }
+
 ISQLData::ptr MySQLStmt::query()
 {
     mysql_stmt_bind_param(m_stmt, &m_binds[0]);
@@ -627,9 +713,9 @@ int MySQLRes::getColumnCount() { return mysql_num_fields(m_data.get()); }
 
 int MySQLRes::getColumnBytes(int idx) { return m_curLength[idx]; }
 
-int MySQLRes::getColumnType(int idx) { return 0; }
+int MySQLRes::getColumnType(int) { return 0; }
 
-std::string MySQLRes::getColumnName(int idx) { return ""; }
+std::string MySQLRes::getColumnName(int) { return ""; }
 
 bool MySQLRes::isNull(int idx)
 {
@@ -775,7 +861,7 @@ int MySQLStmtRes::getColumnBytes(int idx) { return m_datas[idx].length; }
 
 int MySQLStmtRes::getColumnType(int idx) { return m_datas[idx].type; }
 
-std::string MySQLStmtRes::getColumnName(int idx) { return ""; }
+std::string MySQLStmtRes::getColumnName(int) { return ""; }
 
 bool MySQLStmtRes::isNull(int idx) { return m_datas[idx].is_null; }
 
@@ -1079,8 +1165,20 @@ MySQLPool::MySQLPool(const std::string& host, const int32_t port,
       m_user(user),
       m_passwd(passwd),
       m_dbname(dbname),
+      m_maxConn(poolSize),
+      m_minConn(0),
+      m_waitTimeout(1000),
       m_timeout(timeout),
-      m_maxConn(poolSize)
+      m_stmtCacheSize(32),
+      m_total(0),
+      m_stopped(true),
+      m_created(0),
+      m_failed(0),
+      m_timeouts(0),
+      m_waits(0),
+      m_waitMs(0),
+      m_stmtHits(0),
+      m_stmtPrepares(0)
 {
     // 初始化 mysql 库
     mysql_library_init(0, nullptr, nullptr);
@@ -1088,61 +1186,182 @@ MySQLPool::MySQLPool(const std::string& host, const int32_t port,
 
 MySQLPool::~MySQLPool()
 {
-    mysql_library_end();
+    stop();
     for (auto& i : m_conns)
     {
         delete i;
     }
+    mysql_library_end();
 }
 
-MySQL::ptr MySQLPool::get()
+void MySQLPool::start()
 {
-    std::unique_lock<std::mutex> lock(m_mutex);
-    MySQL*                       it = nullptr;
-
-    if (!m_conns.empty())
     {
-        MySQL* rt = m_conns.front();
-        m_conns.pop_front();
-        lock.unlock();
-        if (!rt->isNeedCheck())
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_stopped)
         {
-            rt->m_lastUsedTime = time(0);
-            return MySQL::ptr(rt,
-                std::bind(&MySQLPool::freeMySQL, this, std::placeholders::_1));
+            return;
         }
-        if (rt->ping())
+        m_stopped = false;
+    }
+
+    // 启动时预先建立最小连接数, 避免首批请求排队建连
+    for (uint32_t i = 0; i < m_minConn; ++i)
+    {
         {
-            rt->m_lastUsedTime = time(0);
-            return MySQL::ptr(rt,
-                std::bind(&MySQLPool::freeMySQL, this, std::placeholders::_1));
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_total >= m_maxConn)
+            {
+                break;
+            }
+            m_total++;
         }
-        else if (rt->connect())
+        MySQL* m = create();
+        if (m)
         {
-            rt->m_lastUsedTime = time(0);
-            return MySQL::ptr(rt,
-                std::bind(&MySQLPool::freeMySQL, this, std::placeholders::_1));
+            freeMySQL(m);
         }
-        else
+    }
+
+    m_thread = std::thread(&MySQLPool::keepalive, this);
+}
+
+void MySQLPool::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_stopped)
         {
-            std::cout << "reconnect fail";
-            return nullptr;
+            return;
         }
+        m_stopped = true;
+    }
+    m_stopCond.notify_all();
+    if (m_thread.joinable())
+    {
+        m_thread.join();
     }
-    lock.unlock();
+}
+
+// 调用前需要已经占用了 m_total 的一个名额, 失败时归还
+MySQL* MySQLPool::create()
+{
     MySQL* rt =
         new MySQL(m_host, m_port, m_user, m_passwd, m_dbname, m_timeout);
+    rt->setStmtCacheSize(m_stmtCacheSize);
+    rt->setStmtCounters(&m_stmtHits, &m_stmtPrepares);
     if (rt->connect())
     {
-        rt->m_lastUsedTime = time(0);
-        return MySQL::ptr(
-            rt, std::bind(&MySQLPool::freeMySQL, this, std::placeholders::_1));
+        rt->m_lastUsedTime     = time(0);
+        rt->m_lastCheckoutTime = rt->m_lastUsedTime;
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_created++;
+        return rt;
     }
-    else
+
+    delete rt;
     {
-        delete rt;
-        return nullptr;
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_total--;
+        m_failed++;
     }
+    m_cond.notify_one();
+    return nullptr;
+}
+
+MySQL::ptr MySQLPool::wrap(MySQL* m)
+{
+    m->m_lastUsedTime     = time(0);
+    m->m_lastCheckoutTime = m->m_lastUsedTime;
+    return MySQL::ptr(
+        m, std::bind(&MySQLPool::freeMySQL, this, std::placeholders::_1));
+}
+
+MySQL::ptr MySQLPool::get(bool* timeout)
+{
+    if (timeout)
+    {
+        *timeout = false;
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    auto begin    = std::chrono::steady_clock::now();
+    auto deadline = begin + std::chrono::milliseconds(m_waitTimeout);
+    bool waited   = false;
+    for (;;)
+    {
+        if (!m_conns.empty())
+        {
+            MySQL* rt = m_conns.front();
+            m_conns.pop_front();
+            if (waited)
+            {
+                m_waits++;
+                auto cost = std::chrono::steady_clock::now() - begin;
+                m_waitMs +=
+                    std::chrono::duration_cast<std::chrono::milliseconds>(cost)
+                        .count();
+            }
+            lock.unlock();
+            // 空闲连接由后台线程保活, 这里只处理已知出错的连接
+            if (rt->m_hasError && !rt->ping() && !rt->connect())
+            {
+                delete rt;
+                {
+                    std::lock_guard<std::mutex> guard(m_mutex);
+                    m_total--;
+                    m_failed++;
+                }
+                m_cond.notify_one();
+                return nullptr;
+            }
+            return wrap(rt);
+        }
+
+        if (m_total < m_maxConn)
+        {
+            m_total++;
+            lock.unlock();
+            MySQL* rt = create();
+            if (!rt)
+            {
+                return nullptr;
+            }
+            return wrap(rt);
+        }
+
+        // 连接数已达上限, 有界等待其他请求归还
+        waited = true;
+        if (m_cond.wait_until(lock, deadline) == std::cv_status::timeout &&
+            m_conns.empty() && m_total >= m_maxConn)
+        {
+            m_timeouts++;
+            std::cout << "MySQLPool::get timeout, wait " << m_waitTimeout
+                      << "ms" << std::endl;
+            if (timeout)
+            {
+                *timeout = true;
+            }
+            return nullptr;
+        }
+    }
+}
+
+MySQLPoolStats MySQLPool::getStats()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    MySQLPoolStats              stats;
+    stats.idle         = m_conns.size();
+    stats.inUse        = m_total - m_conns.size();
+    stats.created      = m_created;
+    stats.failed       = m_failed;
+    stats.timeouts     = m_timeouts;
+    stats.waits        = m_waits;
+    stats.waitMs       = m_waitMs;
+    stats.stmtHits     = m_stmtHits;
+    stats.stmtPrepares = m_stmtPrepares;
+    return stats;
 }
 
 void MySQLPool::checkConnection(int sec)
@@ -1152,12 +1371,14 @@ void MySQLPool::checkConnection(int sec)
 
     {
         std::lock_guard<std::mutex> lock(m_mutex);
-        for (auto it = m_conns.begin(); it != m_conns.end();)
+        for (auto it = m_conns.begin();
+             it != m_conns.end() && m_total > m_minConn;)
         {
-            if ((int)(now - (*it)->m_lastUsedTime) >= sec)
+            if ((int)(now - (*it)->m_lastCheckoutTime) >= sec)
             {
                 auto tmp = *it;
                 it       = m_conns.erase(it);
+                m_total--;
                 conns.push_back(tmp);
             }
             else
@@ -1167,12 +1388,79 @@ void MySQLPool::checkConnection(int sec)
         }
     }
 
+    if (conns.empty())
+    {
+        return;
+    }
+    // 归还的名额允许等待中的 get 新建连接
+    m_cond.notify_all();
     for (auto& i : conns)
     {
         delete i;
     }
 }
 
+void MySQLPool::keepalive()
+{
+    int round = 0;
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_stopCond.wait_for(
+                lock, std::chrono::seconds(5), [this] { return m_stopped; });
+            if (m_stopped)
+            {
+                return;
+            }
+        }
+
+        // 取出空闲较久的连接在锁外 ping, 避免阻塞 get
+        std::vector<MySQL*> conns;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (auto it = m_conns.begin(); it != m_conns.end();)
+            {
+                if ((*it)->isNeedCheck(30))
+                {
+                    conns.push_back(*it);
+                    it = m_conns.erase(it);
+                }
+                else
+                {
+                    ++it;
+                }
+            }
+        }
+        for (auto& m : conns)
+        {
+            if (m->ping() || m->connect())
+            {
+                m->m_lastUsedTime = time(0);
+            }
+            freeMySQL(m);
+        }
+
+        // 空闲超过 5 分钟的多余连接收缩回最小连接数
+        checkConnection(300);
+
+        // 每分钟输出一次连接池状态
+        if (++round % 12 == 0)
+        {
+            auto stats = getStats();
+            std::cout << "MySQLPool stats: idle=" << stats.idle
+                      << " in_use=" << stats.inUse
+                      << " created=" << stats.created
+                      << " failed=" << stats.failed
+                      << " timeouts=" << stats.timeouts
+                      << " waits=" << stats.waits
+                      << " wait_ms=" << stats.waitMs
+                      << " stmt_hits=" << stats.stmtHits
+                      << " stmt_prepares=" << stats.stmtPrepares << std::endl;
+        }
+    }
+}
+
 int MySQLPool::execute(const char* format, ...)
 {
     va_list ap;
@@ -1251,12 +1539,19 @@ void MySQLPool::freeMySQL(MySQL* m)
 {
     if (m->m_mysql)
     {
-        std::lock_guard<std::mutex> lock(m_mutex);
-        if (m_conns.size() < m_maxConn)
         {
+            std::lock_guard<std::mutex> lock(m_mutex);
             m_conns.push_back(m);
-            return;
         }
+        m_cond.notify_one();
+        return;
     }
+
+    // 没有建立成功的连接直接关闭, 释放名额给等待者
     delete m;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_total--;
+    }
+    m_cond.notify_one();
 }
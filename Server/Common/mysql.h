@@ -3,15 +3,38 @@
 #include "db.h"
 
 #include <mysql/mysql.h>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <ctime>
 #include <functional>
 #include <memory>
 #include <mutex>
 #include <list>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 
 class MySQL;
 class MySQLStmt;
 
+// 行映射描述, 按查询列的顺序返回目标结构体的成员指针, 例如
+// template <> struct MySQLRowMapper<UserInfo>
+// {
+//     static auto fields()
+//     {
+//         return std::make_tuple(&UserInfo::uid_, &UserInfo::name_);
+//     }
+// };
+// 同一结构体需要多种列组合时, 另写一个带 fields() 的类型作为 Mapper 传入
+template <typename T>
+struct MySQLRowMapper;
+
 struct MySQLTime
 {
     MySQLTime(time_t t) : ts(t) {}
@@ -137,6 +160,7 @@ class MySQL : public IDB, public std::enable_shared_from_this<MySQL>
     MySQL(const std::string& host, const int32_t port, const std::string& user,
         const std::string& passwd, const std::string& dbname,
         const int32_t timeout);
+    ~MySQL();
 
     bool connect();
     bool ping();
@@ -162,6 +186,16 @@ class MySQL : public IDB, public std::enable_shared_from_this<MySQL>
     template <class... Args>
     ISQLData::ptr queryStmt(const char* stmt, Args&&... args);
 
+    // 结果列直接写入 T 的成员, 没有 ISQLData 的虚调用和中间缓冲
+    template <typename T, typename Mapper = MySQLRowMapper<T>,
+        typename... Args>
+    bool queryAs(std::vector<T>& rows, const char* stmt, Args&&... args);
+
+    // 逐行回调 cb(T&), T 中的 string_view 成员只在本次回调内有效
+    template <typename T, typename Mapper = MySQLRowMapper<T>, typename Func,
+        typename... Args>
+    bool foreachAs(Func&& cb, const char* stmt, Args&&... args);
+
     const char* cmd();
 
     bool        use(const std::string& dbname);
@@ -169,10 +203,28 @@ class MySQL : public IDB, public std::enable_shared_from_this<MySQL>
     std::string getErrStr() override;
     uint64_t    getInsertId();
 
+    // 预处理语句缓存, 按 sql 文本做 LRU
+    // 取出的语句在归还前不会再被其他调用复用
+    MYSQL_STMT* acquireStmt(const std::string& sql);
+    void        releaseStmt(const std::string& sql, MYSQL_STMT* stmt);
+    void        clearStmtCache();
+
+    size_t getStmtCacheSize() const { return m_stmtCacheSize; }
+    void   setStmtCacheSize(size_t v) { m_stmtCacheSize = v; }
+    // 缓存命中与重新 prepare 的次数累加到连接池的计数上
+    void setStmtCounters(
+        std::atomic<uint64_t>* hits, std::atomic<uint64_t>* prepares)
+    {
+        m_stmtHits     = hits;
+        m_stmtPrepares = prepares;
+    }
+
   private:
-    bool isNeedCheck();
+    bool isNeedCheck(int sec);
 
   private:
+    typedef std::list<std::pair<std::string, MYSQL_STMT*>> StmtList;
+
     std::shared_ptr<MYSQL> m_mysql;
 
     std::string m_cmd;
@@ -184,8 +236,18 @@ class MySQL : public IDB, public std::enable_shared_from_this<MySQL>
     std::string m_dbname;
     int32_t     m_timeout;
 
-    uint64_t m_lastUsedTime;
-    bool     m_hasError;
+    // 最近一次 ping 或借出的时间, 用于保活
+    time_t m_lastUsedTime;
+    // 最近一次被借出的时间, 保活 ping 不更新, 用于空闲回收
+    time_t m_lastCheckoutTime;
+    bool   m_hasError;
+
+    size_t                                              m_stmtCacheSize;
+    StmtList                                            m_stmtLru;
+    std::unordered_map<std::string, StmtList::iterator> m_stmtCache;
+    std::unordered_set<MYSQL_STMT*>                     m_stmtOut;
+    std::atomic<uint64_t>*                              m_stmtHits;
+    std::atomic<uint64_t>*                              m_stmtPrepares;
 };
 
 class MySQLTransaction : public ITransaction
@@ -271,17 +333,38 @@ class MySQLStmt : public IStmt, public std::enable_shared_from_this<MySQLStmt>
     int64_t       getLastInsertId() override;
     ISQLData::ptr query() override;
 
+    // 执行并把结果全部取到客户端, 按 Mapper 描述逐行回调, 见 MySQL::foreachAs
+    template <typename T, typename Mapper = MySQLRowMapper<T>, typename Func>
+    bool fetchAs(Func&& cb);
+
     MYSQL_STMT* getRaw() const { return m_stmt; }
 
   protected:
-    MySQLStmt(MySQL::ptr db, MYSQL_STMT* stmt);
+    MySQLStmt(MySQL::ptr db, MYSQL_STMT* stmt, const std::string& sql);
+
+    int  executeStore();
+    void freeResult();
 
   private:
     MySQL::ptr              m_mysql;
     MYSQL_STMT*             m_stmt;
+    std::string             m_sql;
     std::vector<MYSQL_BIND> m_binds;
 };
 
+struct MySQLPoolStats
+{
+    uint32_t idle;
+    uint32_t inUse;
+    uint64_t created;       // 累计新建的连接数
+    uint64_t failed;        // 累计建立失败的次数
+    uint64_t timeouts;      // 等待连接超时的次数
+    uint64_t waits;         // 需要等待才拿到连接的次数
+    uint64_t waitMs;        // 累计等待时间
+    uint64_t stmtHits;      // 预处理语句缓存命中次数
+    uint64_t stmtPrepares;  // 未命中而重新 prepare 的次数
+};
+
 class MySQLPool
 {
   public:
@@ -291,12 +374,28 @@ class MySQLPool
         const int32_t timeout);
     ~MySQLPool();
 
-    MySQL::ptr get();
+    // 预热最小连接数并启动后台保活线程
+    void start();
+    void stop();
+
+    // 连接数已达上限时最多等待 waitTimeout 毫秒, 超时返回 nullptr
+    // timeout 非空时标记失败原因: true 为等待超时, false 为连接失败
+    MySQL::ptr get(bool* timeout = nullptr);
 
+    // 关闭空闲超过 sec 秒且超出最小连接数的连接
     void checkConnection(int sec = 30);
 
     uint32_t getMaxConn() const { return m_maxConn; }
     void     setMaxConn(uint32_t v) { m_maxConn = v; }
+    uint32_t getMinConn() const { return m_minConn; }
+    void     setMinConn(uint32_t v) { m_minConn = v; }
+    uint32_t getWaitTimeout() const { return m_waitTimeout; }
+    void     setWaitTimeout(uint32_t v) { m_waitTimeout = v; }
+
+    size_t getStmtCacheSize() const { return m_stmtCacheSize; }
+    void   setStmtCacheSize(size_t v) { m_stmtCacheSize = v; }
+
+    MySQLPoolStats getStats();
 
     int execute(const char* format, ...);
     int execute(const char* format, va_list ap);
@@ -309,7 +408,10 @@ class MySQLPool
     MySQLTransaction::ptr openTransaction(bool auto_commit = true);
 
   private:
-    void freeMySQL(MySQL* m);
+    void       freeMySQL(MySQL* m);
+    MySQL*     create();
+    MySQL::ptr wrap(MySQL* m);
+    void       keepalive();
 
   private:
     std::string       m_host;
@@ -317,10 +419,29 @@ class MySQLPool
     std::string       m_user;
     std::string       m_passwd;
     std::string       m_dbname;
-    int32_t           m_maxConn;
+    uint32_t          m_maxConn;
+    uint32_t          m_minConn;
+    uint32_t          m_waitTimeout;
     int32_t           m_timeout;
+    size_t            m_stmtCacheSize;
     std::mutex        m_mutex;
     std::list<MySQL*> m_conns;
+    // 已创建(含正在创建)的连接总数, 不超过 m_maxConn
+    uint32_t                m_total;
+    std::condition_variable m_cond;
+
+    bool                    m_stopped;
+    std::condition_variable m_stopCond;
+    std::thread             m_thread;
+
+    uint64_t m_created;
+    uint64_t m_failed;
+    uint64_t m_timeouts;
+    uint64_t m_waits;
+    uint64_t m_waitMs;
+
+    std::atomic<uint64_t> m_stmtHits;
+    std::atomic<uint64_t> m_stmtPrepares;
 };
 
 namespace
@@ -329,7 +450,7 @@ namespace
 template <size_t N, typename... Args>
 struct MySQLBinder
 {
-    static int Bind(std::shared_ptr<MySQLStmt> stmt) { return 0; }
+    static int Bind(std::shared_ptr<MySQLStmt>) { return 0; }
 };
 
 template <typename... Args>
@@ -415,3 +536,217 @@ XX(double, double&);
 // XX(MYSQL_TIME, MYSQL_TIME&);
 #undef XX
 }  // namespace
+
+namespace mysql_row
+{
+
+// 成员类型到 MYSQL_BIND 缓冲类型的映射, 数值类型由客户端库负责转换
+template <typename M>
+struct FieldType;
+
+#define XX(type, mtype, uns)                                      \
+    template <>                                                   \
+    struct FieldType<type>                                        \
+    {                                                             \
+        static constexpr enum_field_types value      = mtype;     \
+        static constexpr bool             isUnsigned = uns;       \
+        static constexpr bool             isString   = false;     \
+    };
+
+XX(int8_t, MYSQL_TYPE_TINY, false);
+XX(uint8_t, MYSQL_TYPE_TINY, true);
+XX(int16_t, MYSQL_TYPE_SHORT, false);
+XX(uint16_t, MYSQL_TYPE_SHORT, true);
+XX(int32_t, MYSQL_TYPE_LONG, false);
+XX(uint32_t, MYSQL_TYPE_LONG, true);
+XX(int64_t, MYSQL_TYPE_LONGLONG, false);
+XX(uint64_t, MYSQL_TYPE_LONGLONG, true);
+XX(float, MYSQL_TYPE_FLOAT, false);
+XX(double, MYSQL_TYPE_DOUBLE, false);
+#undef XX
+
+template <>
+struct FieldType<std::string>
+{
+    static constexpr enum_field_types value      = MYSQL_TYPE_STRING;
+    static constexpr bool             isUnsigned = false;
+    static constexpr bool             isString   = true;
+};
+
+template <>
+struct FieldType<std::string_view> : FieldType<std::string>
+{};
+
+template <typename P>
+struct MemberType;
+
+template <typename C, typename M>
+struct MemberType<M C::*>
+{
+    typedef M type;
+};
+
+struct Column
+{
+    unsigned long length;
+    bool          is_null;
+    bool          error;
+    std::string   buf;  // string_view 成员指向的缓冲, 每行复用
+};
+
+template <typename M>
+void bindField(M& member, MYSQL_BIND& bind, Column& col)
+{
+    memset(&bind, 0, sizeof(bind));
+    bind.buffer_type = FieldType<M>::value;
+    bind.is_unsigned = FieldType<M>::isUnsigned;
+    bind.length      = &col.length;
+    bind.is_null     = &col.is_null;
+    bind.error       = &col.error;
+    // 定长类型直接绑定到成员, 变长类型先只取长度, 再按长度单独读取
+    if constexpr (!FieldType<M>::isString)
+    {
+        bind.buffer        = &member;
+        bind.buffer_length = sizeof(M);
+    }
+}
+
+template <typename M>
+bool fetchField(MYSQL_STMT* stmt, unsigned int idx, M& member,
+    MYSQL_BIND& bind, Column& col)
+{
+    if (col.is_null)
+    {
+        member = M();
+        return true;
+    }
+    if constexpr (FieldType<M>::isString)
+    {
+        // std::string 直接读进成员自己的存储, string_view 指向列缓冲
+        std::string* buf = &col.buf;
+        if constexpr (std::is_same<M, std::string>::value)
+        {
+            buf = &member;
+        }
+        buf->resize(col.length);
+        if (col.length > 0)
+        {
+            bind.buffer        = &(*buf)[0];
+            bind.buffer_length = col.length;
+            int rt             = mysql_stmt_fetch_column(stmt, &bind, idx, 0);
+            bind.buffer        = nullptr;
+            bind.buffer_length = 0;
+            if (rt != 0)
+            {
+                return false;
+            }
+        }
+        if constexpr (std::is_same<M, std::string_view>::value)
+        {
+            member = std::string_view(buf->data(), buf->size());
+        }
+    }
+    return true;
+}
+
+template <typename T, typename Tuple, size_t... I>
+void bindRow(T& row, const Tuple& fields, MYSQL_BIND* binds, Column* cols,
+    std::index_sequence<I...>)
+{
+    (bindField(row.*std::get<I>(fields), binds[I], cols[I]), ...);
+}
+
+template <typename T, typename Tuple, size_t... I>
+bool fetchRow(MYSQL_STMT* stmt, T& row, const Tuple& fields, MYSQL_BIND* binds,
+    Column* cols, std::index_sequence<I...>)
+{
+    return (fetchField(stmt, I, row.*std::get<I>(fields), binds[I], cols[I]) &&
+            ...);
+}
+
+template <typename Tuple>
+struct HasView;
+
+template <typename... P>
+struct HasView<std::tuple<P...>>
+{
+    static constexpr bool value =
+        (std::is_same<typename MemberType<P>::type, std::string_view>::value ||
+            ...);
+};
+
+}  // namespace mysql_row
+
+template <typename T, typename Mapper, typename Func>
+bool MySQLStmt::fetchAs(Func&& cb)
+{
+    auto             fields = Mapper::fields();
+    constexpr size_t N      = std::tuple_size<decltype(fields)>::value;
+    static_assert(N > 0, "empty row mapper");
+
+    if (executeStore() != 0)
+    {
+        return false;
+    }
+    if (mysql_stmt_field_count(m_stmt) != N)
+    {
+        freeResult();
+        return false;
+    }
+
+    T                 row;
+    MYSQL_BIND        binds[N];
+    mysql_row::Column cols[N];
+    mysql_row::bindRow(row, fields, binds, cols, std::make_index_sequence<N>());
+    if (mysql_stmt_bind_result(m_stmt, binds))
+    {
+        freeResult();
+        return false;
+    }
+
+    bool ok = true;
+    while (true)
+    {
+        // 变长列没有缓冲, 会返回 MYSQL_DATA_TRUNCATED, 随后按列读取
+        int rt = mysql_stmt_fetch(m_stmt);
+        if (rt == MYSQL_NO_DATA)
+        {
+            break;
+        }
+        if (rt == 1 || !mysql_row::fetchRow(m_stmt, row, fields, binds, cols,
+                           std::make_index_sequence<N>()))
+        {
+            ok = false;
+            break;
+        }
+        cb(row);
+    }
+    freeResult();
+    return ok;
+}
+
+template <typename T, typename Mapper, typename Func, typename... Args>
+bool MySQL::foreachAs(Func&& cb, const char* stmt, Args&&... args)
+{
+    auto st = MySQLStmt::Create(shared_from_this(), stmt);
+    if (!st)
+    {
+        return false;
+    }
+    int rt = bindX(st, args...);
+    if (rt != 0)
+    {
+        return false;
+    }
+    return st->template fetchAs<T, Mapper>(std::forward<Func>(cb));
+}
+
+template <typename T, typename Mapper, typename... Args>
+bool MySQL::queryAs(std::vector<T>& rows, const char* stmt, Args&&... args)
+{
+    static_assert(!mysql_row::HasView<decltype(Mapper::fields())>::value,
+        "string_view fields are only valid inside foreachAs");
+    return foreachAs<T, Mapper>(
+        [&rows](T& row) { rows.push_back(std::move(row)); }, stmt,
+        std::forward<Args>(args)...);
+}
@@ -1,6 +1,8 @@
 #include "redis.h"
 
 #include <memory.h>
+#include <errno.h>
+#include <poll.h>
 #include <iostream>
 #include <functional>
 
@@ -45,9 +47,11 @@ redisReply* RedisReplyClone(redisReply* r)
 
 Redis::Redis(const std::string& host, int32_t port, const std::string& passwd)
 {
-    m_host   = host;
-    m_port   = port;
-    m_passwd = passwd;
+    m_host       = host;
+    m_port       = port;
+    m_passwd     = passwd;
+    m_connectMs  = 0;
+    m_cmdTimeout = {0, 0};
 }
 
 bool Redis::reconnect()
@@ -184,6 +188,7 @@ ReplyPtr Redis::cmd(const char* fmt, va_list ap)
 
     if (!r)
     {
+        m_lastError = m_context->errstr;
         std::cout << "redisCommand error: (" << fmt << ")(" << m_host << ":"
                   << m_port << ")" << std::endl;
         return nullptr;
@@ -192,8 +197,10 @@ ReplyPtr Redis::cmd(const char* fmt, va_list ap)
     ReplyPtr rt(r, freeReplyObject);
     if (r->type != REDIS_REPLY_ERROR)
     {
+        m_lastError.clear();
         return rt;
     }
+    m_lastError.assign(r->str, r->len);
 
     std::cout << "redisCommand error: (" << fmt << ")(" << m_host << ":"
               << m_port << ")"
@@ -215,6 +222,7 @@ ReplyPtr Redis::cmd(const std::vector<std::string>& argv)
         m_context.get(), argv.size(), &v[0], &l[0]);
     if (!r)
     {
+        m_lastError = m_context->errstr;
         std::cout << "redisCommandArgv error: (" << m_host << ":" << m_port
                   << ")" << std::endl;
         return nullptr;
@@ -222,14 +230,40 @@ ReplyPtr Redis::cmd(const std::vector<std::string>& argv)
     ReplyPtr rt(r, freeReplyObject);
     if (r->type != REDIS_REPLY_ERROR)
     {
+        m_lastError.clear();
         return rt;
     }
+    m_lastError.assign(r->str, r->len);
 
     std::cout << "redisCommandArgv error: (" << m_host << ":" << m_port << ")("
               << r->str << ")" << std::endl;
     return nullptr;
 }
 
+ReplyPtr Redis::cmdFormatted(const char* buf, size_t len)
+{
+    redisReply* r = nullptr;
+    if (redisAppendFormattedCommand(m_context.get(), buf, len) != REDIS_OK ||
+        redisGetReply(m_context.get(), (void**)&r) != REDIS_OK || !r)
+    {
+        m_lastError = m_context->errstr;
+        std::cout << "redisCommand error: (" << m_host << ":" << m_port << ")"
+                  << std::endl;
+        return nullptr;
+    }
+    ReplyPtr rt(r, freeReplyObject);
+    if (r->type != REDIS_REPLY_ERROR)
+    {
+        m_lastError.clear();
+        return rt;
+    }
+    m_lastError.assign(r->str, r->len);
+
+    std::cout << "redisCommand error: (" << m_host << ":" << m_port << ")("
+              << r->str << ")" << std::endl;
+    return nullptr;
+}
+
 ReplyPtr Redis::getReply()
 {
     redisReply* r = nullptr;
@@ -243,6 +277,62 @@ ReplyPtr Redis::getReply()
     return nullptr;
 }
 
+int Redis::waitReply(ReplyPtr& reply, uint64_t ms)
+{
+    redisContext* c = m_context.get();
+    if (!c || c->err)
+    {
+        return -1;
+    }
+
+    // 先从已读取的缓冲中取回复, 没有再等待 socket 可读
+    void* r = nullptr;
+    if (redisGetReplyFromReader(c, &r) == REDIS_ERR)
+    {
+        return -1;
+    }
+    if (!r)
+    {
+        struct pollfd pfd;
+        pfd.fd      = c->fd;
+        pfd.events  = POLLIN;
+        pfd.revents = 0;
+        int n       = ::poll(&pfd, 1, (int)ms);
+        if (n == 0 || (n < 0 && errno == EINTR))
+        {
+            return 0;
+        }
+        if (n < 0 || redisBufferRead(c) == REDIS_ERR ||
+            redisGetReplyFromReader(c, &r) == REDIS_ERR)
+        {
+            std::cout << "redis waitReply error: (" << m_host << ":" << m_port
+                      << ")" << std::endl;
+            return -1;
+        }
+        if (!r)
+        {
+            return 0;
+        }
+    }
+    reply.reset((redisReply*)r, freeReplyObject);
+    return 1;
+}
+
+bool Redis::flush()
+{
+    int done = 0;
+    while (!done)
+    {
+        if (redisBufferWrite(m_context.get(), &done) == REDIS_ERR)
+        {
+            std::cout << "redisBufferWrite error: (" << m_host << ":" << m_port
+                      << ")" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
 int Redis::appendCmd(const char* fmt, ...)
 {
     va_list ap;
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "RedisEncoder.h"
+
 #include <hiredis/hiredis.h>
 #include <stdlib.h>
 #include <sys/time.h>
@@ -27,11 +29,27 @@ class IRedis
     virtual ReplyPtr cmd(const char* fmt, va_list ap)          = 0;
     virtual ReplyPtr cmd(const std::vector<std::string>& argv) = 0;
 
+    // 执行已经编码好的 RESP 命令
+    virtual ReplyPtr cmdFormatted(const char* buf, size_t len) = 0;
+
+    // 参数可以是 string/string_view/字符串字面量/整数/vector<string>
+    template <typename... Args>
+    ReplyPtr exec(const Args&... args)
+    {
+        m_encoder.encode(args...);
+        return cmdFormatted(m_encoder.data(), m_encoder.size());
+    }
+
     const std::string& getPasswd() const { return m_passwd; }
     void               setPasswd(const std::string& v) { m_passwd = v; }
 
+    // 最近一次 cmd 返回的错误信息, 成功时为空
+    const std::string& getLastError() const { return m_lastError; }
+
   protected:
-    std::string m_passwd;
+    std::string  m_passwd;
+    std::string  m_lastError;
+    RedisEncoder m_encoder;
 };
 
 class ISyncRedis : public IRedis
@@ -72,6 +90,7 @@ class Redis : public ISyncRedis
     virtual ReplyPtr cmd(const char* fmt, ...);
     virtual ReplyPtr cmd(const char* fmt, va_list ap);
     virtual ReplyPtr cmd(const std::vector<std::string>& argv);
+    virtual ReplyPtr cmdFormatted(const char* buf, size_t len);
 
     virtual int appendCmd(const char* fmt, ...);
     virtual int appendCmd(const char* fmt, va_list ap);
@@ -79,6 +98,12 @@ class Redis : public ISyncRedis
 
     virtual ReplyPtr getReply();
 
+    // 等待一个回复, 最多阻塞 ms 毫秒, 用于订阅连接
+    // 返回 1 表示收到回复, 0 表示超时, -1 表示连接出错
+    int waitReply(ReplyPtr& reply, uint64_t ms);
+    // 将 appendCmd 缓冲的命令全部写出
+    bool flush();
+
   private:
     std::string                   m_host;
     uint32_t                      m_port;
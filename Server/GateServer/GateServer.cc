@@ -1,11 +1,48 @@
 #include "GateServer.h"
 #include "AsioIOServicePool.h"
+#include "ConfigMgr.h"
 #include "HttpConnection.h"
 #include "Logger.h"
+#include "LogicSystem.h"
 
 GateServer::GateServer(boost::asio::io_context& ioc, unsigned short& port)
-    : ioc_(ioc), acceptor_(ioc, tcp::endpoint(tcp::v4(), port))
-{}
+    : acceptor_(ioc), ioc_(ioc), drain_timer_(ioc)
+{
+    auto& cfg = ConfigMgr::Inst();
+    // ReusePort 允许新进程在旧进程排空期间绑定同一端口, 实现不停机重启
+    tcp::endpoint endpoint(tcp::v4(), port);
+    acceptor_.open(endpoint.protocol());
+    acceptor_.set_option(tcp::acceptor::reuse_address(true));
+    if (cfg["GateServer"]["ReusePort"] == "true")
+    {
+        acceptor_.set_option(
+            net::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>(
+                true));
+    }
+    acceptor_.bind(endpoint);
+    acceptor_.listen();
+
+    // 长连接空闲超时（秒）与单连接最大请求数，未配置时使用默认值
+    std::string timeout_str  = cfg["GateServer"]["KeepAliveTimeout"];
+    std::string max_reqs_str = cfg["GateServer"]["MaxKeepAliveRequests"];
+    keep_alive_timeout_ =
+        std::chrono::seconds(timeout_str.empty() ? 15 : std::stoi(timeout_str));
+    max_keep_alive_requests_ =
+        max_reqs_str.empty() ? 100 : std::stoi(max_reqs_str);
+    // 单个请求体的字节数上限
+    std::string body_limit_str = cfg["GateServer"]["BodyLimit"];
+    body_limit_ =
+        body_limit_str.empty() ? 64 * 1024 : std::stoull(body_limit_str);
+    // 是否接受 h2c (prior knowledge) 连接, 需要编译时找到 nghttp2
+    http2_ = cfg["GateServer"]["Http2"] == "true";
+#ifndef GATESERVER_HTTP2
+    if (http2_)
+    {
+        LOG_WARN("GateServer built without nghttp2, Http2 ignored");
+        http2_ = false;
+    }
+#endif
+}
 
 void GateServer::Start()
 {
@@ -13,12 +50,19 @@ void GateServer::Start()
     auto& io_context = AsioIOServicePool::GetInstance()->GetIOService();
 
     std::shared_ptr<HttpConnection> new_con =
-        std::make_shared<HttpConnection>(io_context);
+        std::make_shared<HttpConnection>(
+            io_context, keep_alive_timeout_, max_keep_alive_requests_,
+            body_limit_, http2_);
 
     acceptor_.async_accept(
         new_con->GetSocket(), [self, new_con](beast::error_code ec) {
             try
             {
+                // 排空时 acceptor 已关闭, 不再监听
+                if (ec == net::error::operation_aborted)
+                {
+                    return;
+                }
                 // 出错则放弃这个连接，继续监听新链接
                 if (ec)
                 {
@@ -38,3 +82,36 @@ void GateServer::Start()
             }
         });
 }
+
+void GateServer::Drain(
+    std::chrono::milliseconds deadline, std::function<void()> done)
+{
+    beast::error_code ec;
+    acceptor_.close(ec);
+    LogicSystem::GetInstance()->Drain();
+    LOG_INFO("GateServer draining, in flight: {}",
+             LogicSystem::GetInstance()->InFlight());
+    CheckDrained(std::chrono::steady_clock::now() + deadline, done);
+}
+
+void GateServer::CheckDrained(
+    std::chrono::steady_clock::time_point until, std::function<void()> done)
+{
+    int in_flight = LogicSystem::GetInstance()->InFlight();
+    if (in_flight == 0 || std::chrono::steady_clock::now() >= until)
+    {
+        LOG_INFO("GateServer drained, in flight: {}", in_flight);
+        done();
+        return;
+    }
+
+    auto self = shared_from_this();
+    drain_timer_.expires_after(std::chrono::milliseconds(100));
+    drain_timer_.async_wait([self, until, done](beast::error_code ec) {
+        if (ec)
+        {
+            return;
+        }
+        self->CheckDrained(until, done);
+    });
+}
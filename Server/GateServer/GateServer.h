@@ -3,6 +3,8 @@
 #include <boost/asio.hpp>
 #include <boost/beast.hpp>
 #include <boost/beast/http.hpp>
+#include <chrono>
+#include <functional>
 #include <memory>
 
 namespace net = boost::asio;           // from <boost/asio.hpp>
@@ -13,8 +15,20 @@ class GateServer : public std::enable_shared_from_this<GateServer>
   public:
     GateServer(boost::asio::io_context& ioc, unsigned short& port);
     void Start();
+    // 停止接受新连接, 已交给处理函数的请求写回或超过 deadline 后调用 done
+    void Drain(std::chrono::milliseconds deadline, std::function<void()> done);
 
   private:
+    void CheckDrained(std::chrono::steady_clock::time_point until,
+        std::function<void()> done);
+
     tcp::acceptor    acceptor_;
     net::io_context& ioc_;
+
+    std::chrono::seconds keep_alive_timeout_;
+    int                  max_keep_alive_requests_;
+    uint64_t             body_limit_;
+    bool                 http2_;
+
+    net::steady_timer drain_timer_;
 };
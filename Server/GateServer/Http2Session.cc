@@ -0,0 +1,485 @@
+#include "Http2Session.h"
+
+#ifdef GATESERVER_HTTP2
+
+#include "HttpConnection.h"
+#include "Logger.h"
+#include "LogicSystem.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+// 单个连接上同时处理的流数
+constexpr uint32_t kMaxConcurrentStreams = 100;
+// 单个流从收到头部到提交响应的最长时间
+constexpr std::chrono::seconds kStreamTimeout(60);
+
+nghttp2_nv MakeNv(std::string_view name, std::string_view value)
+{
+    return {(uint8_t*)name.data(), (uint8_t*)value.data(), name.size(),
+        value.size(), NGHTTP2_NV_FLAG_NONE};
+}
+
+// HTTP/2 禁止携带逐跳头部
+bool IsConnectionHeader(http::field field)
+{
+    return field == http::field::connection ||
+           field == http::field::keep_alive ||
+           field == http::field::proxy_connection ||
+           field == http::field::transfer_encoding ||
+           field == http::field::upgrade;
+}
+}  // namespace
+
+Http2Session::Http2Session(tcp::socket socket,
+    std::chrono::seconds idle_timeout, uint64_t body_limit)
+    : socket_(std::move(socket)),
+      deadline_(socket_.get_executor()),
+      stream_timer_(socket_.get_executor()),
+      idle_timeout_(idle_timeout),
+      body_limit_(body_limit)
+{}
+
+Http2Session::~Http2Session()
+{
+    if (session_ != nullptr)
+    {
+        nghttp2_session_del(session_);
+    }
+}
+
+void Http2Session::Start(std::string_view initial)
+{
+    beast::error_code ec;
+    remote_ = socket_.remote_endpoint(ec).address();
+
+    nghttp2_session_callbacks* callbacks;
+    nghttp2_session_callbacks_new(&callbacks);
+    nghttp2_session_callbacks_set_on_begin_headers_callback(
+        callbacks, &Http2Session::OnBeginHeaders);
+    nghttp2_session_callbacks_set_on_header_callback(
+        callbacks, &Http2Session::OnHeader);
+    nghttp2_session_callbacks_set_on_data_chunk_recv_callback(
+        callbacks, &Http2Session::OnDataChunk);
+    nghttp2_session_callbacks_set_on_frame_recv_callback(
+        callbacks, &Http2Session::OnFrameRecv);
+    nghttp2_session_callbacks_set_on_frame_send_callback(
+        callbacks, &Http2Session::OnFrameSend);
+    nghttp2_session_callbacks_set_on_stream_close_callback(
+        callbacks, &Http2Session::OnStreamClose);
+    nghttp2_session_server_new(&session_, callbacks, this);
+    nghttp2_session_callbacks_del(callbacks);
+
+    nghttp2_settings_entry settings[] = {
+        {NGHTTP2_SETTINGS_MAX_CONCURRENT_STREAMS, kMaxConcurrentStreams}};
+    nghttp2_submit_settings(session_, NGHTTP2_FLAG_NONE, settings, 1);
+
+    deadline_.expires_after(idle_timeout_);
+    CheckDeadline();
+    CheckStreams();
+    if (!Receive(initial.data(), initial.size()))
+    {
+        Close();
+        return;
+    }
+    DoWrite();
+    DoRead();
+}
+
+bool Http2Session::Receive(const char* data, size_t len)
+{
+    // 回调中提交的响应等 mem_recv 返回后统一发送
+    receiving_ = true;
+    ssize_t rv = nghttp2_session_mem_recv(session_, (const uint8_t*)data, len);
+    receiving_ = false;
+    if (rv < 0)
+    {
+        LOG_ERROR("Http2 recv err, {}", nghttp2_strerror((int)rv));
+        return false;
+    }
+    return true;
+}
+
+void Http2Session::DoRead()
+{
+    auto self = shared_from_this();
+    socket_.async_read_some(net::buffer(read_buf_),
+        [self](beast::error_code ec, std::size_t bytes) {
+            if (ec)
+            {
+                if (ec != net::error::eof &&
+                    ec != net::error::operation_aborted)
+                {
+                    LOG_ERROR("Http2 read err, {}", ec.message());
+                }
+                self->Close();
+                return;
+            }
+            self->deadline_.expires_after(self->idle_timeout_);
+            self->CheckDeadline();
+            if (!self->Receive(self->read_buf_.data(), bytes))
+            {
+                self->Close();
+                return;
+            }
+            self->DoWrite();
+            if (!self->closed_ && nghttp2_session_want_read(self->session_))
+            {
+                self->DoRead();
+            }
+        });
+}
+
+void Http2Session::DoWrite()
+{
+    if (writing_ || closed_)
+    {
+        return;
+    }
+    write_buf_.clear();
+    for (;;)
+    {
+        const uint8_t* data = nullptr;
+        ssize_t        len  = nghttp2_session_mem_send(session_, &data);
+        if (len < 0)
+        {
+            LOG_ERROR("Http2 send err, {}", nghttp2_strerror((int)len));
+            Close();
+            return;
+        }
+        if (len == 0)
+        {
+            break;
+        }
+        write_buf_.append((const char*)data, len);
+    }
+    if (write_buf_.empty())
+    {
+        // 双方都发送了 GOAWAY 且没有未完成的流
+        if (!nghttp2_session_want_read(session_) &&
+            !nghttp2_session_want_write(session_))
+        {
+            Close();
+        }
+        return;
+    }
+
+    writing_  = true;
+    auto self = shared_from_this();
+    net::async_write(socket_, net::buffer(write_buf_),
+        [self](beast::error_code ec, std::size_t) {
+            self->writing_ = false;
+            if (ec)
+            {
+                self->Close();
+                return;
+            }
+            self->DoWrite();
+        });
+}
+
+void Http2Session::CheckDeadline()
+{
+    auto self = shared_from_this();
+    deadline_.async_wait([self](beast::error_code ec) {
+        if (ec || self->closed_)
+        {
+            return;
+        }
+        // 还有流在处理时继续等待, 否则发送 GOAWAY 后关闭
+        if (!self->streams_.empty())
+        {
+            self->deadline_.expires_after(self->idle_timeout_);
+            self->CheckDeadline();
+            return;
+        }
+        nghttp2_session_terminate_session(self->session_, NGHTTP2_NO_ERROR);
+        self->DoWrite();
+    });
+}
+
+void Http2Session::CheckStreams()
+{
+    auto self = shared_from_this();
+    stream_timer_.expires_after(std::chrono::seconds(1));
+    stream_timer_.async_wait([self](beast::error_code ec) {
+        if (ec || self->closed_)
+        {
+            return;
+        }
+        // 处理函数仍在业务线程中, 不能改写它的响应, 只重置流
+        // 处理函数完成后找不到流, 响应直接丢弃
+        auto now     = std::chrono::steady_clock::now();
+        bool expired = false;
+        for (auto& stream : self->streams_)
+        {
+            if (stream.second.responded || stream.second.deadline > now)
+            {
+                continue;
+            }
+            LOG_WARN("Http2 stream timeout, stream: {}", stream.first);
+            stream.second.responded = true;
+            nghttp2_submit_rst_stream(self->session_, NGHTTP2_FLAG_NONE,
+                stream.first, NGHTTP2_INTERNAL_ERROR);
+            expired = true;
+        }
+        if (expired)
+        {
+            self->DoWrite();
+        }
+        self->CheckStreams();
+    });
+}
+
+void Http2Session::Close()
+{
+    if (closed_)
+    {
+        return;
+    }
+    closed_ = true;
+    beast::error_code ec;
+    socket_.shutdown(tcp::socket::shutdown_both, ec);
+    socket_.close(ec);
+    deadline_.cancel();
+    stream_timer_.cancel();
+    // 仍在业务线程中的流完成后会发现连接已关闭, 直接丢弃响应
+    for (auto& stream : streams_)
+    {
+        stream.second.con->in_flight_.reset();
+    }
+    streams_.clear();
+}
+
+void Http2Session::SubmitResponse(int32_t stream_id)
+{
+    if (closed_)
+    {
+        return;
+    }
+    auto it = streams_.find(stream_id);
+    if (it == streams_.end() || it->second.responded)
+    {
+        // 客户端已经取消了这个流, 或者流已超时重置
+        return;
+    }
+    it->second.responded = true;
+
+    auto& response = it->second.con->response_;
+    response.content_length(response.body().size());
+
+    // nghttp2 会拷贝头部, 这里只需保证提交期间有效
+    std::string status = std::to_string(response.result_int());
+    size_t      fields = std::distance(response.begin(), response.end());
+    std::vector<std::string> names;
+    std::vector<nghttp2_nv>  nva;
+    names.reserve(fields);
+    nva.reserve(fields + 1);
+    nva.push_back(MakeNv(":status", status));
+    for (auto& field : response)
+    {
+        if (IsConnectionHeader(field.name()))
+        {
+            continue;
+        }
+        // HTTP/2 要求头部名为小写
+        auto name = field.name_string();
+        auto lower = names.emplace(names.end(), name.data(), name.size());
+        std::transform(lower->begin(), lower->end(), lower->begin(),
+            [](unsigned char c) { return std::tolower(c); });
+        auto value = field.value();
+        nva.push_back(
+            MakeNv(*lower, std::string_view(value.data(), value.size())));
+    }
+
+    nghttp2_data_provider provider;
+    provider.source.ptr    = nullptr;
+    provider.read_callback = &Http2Session::ReadBody;
+    int rv = nghttp2_submit_response(session_, stream_id, nva.data(),
+        nva.size(), response.body().empty() ? nullptr : &provider);
+    if (rv != 0)
+    {
+        LOG_ERROR("Http2 submit response err, {}", nghttp2_strerror(rv));
+        return;
+    }
+    // 排空时发送 GOAWAY, 已开始的流处理完后连接自然关闭
+    if (!goaway_sent_ && LogicSystem::GetInstance()->Draining())
+    {
+        goaway_sent_ = true;
+        nghttp2_submit_goaway(session_, NGHTTP2_FLAG_NONE,
+            nghttp2_session_get_last_proc_stream_id(session_),
+            NGHTTP2_NO_ERROR, nullptr, 0);
+    }
+    // mem_recv 的回调中不能调用 mem_send
+    if (!receiving_)
+    {
+        DoWrite();
+    }
+}
+
+int Http2Session::OnBeginHeaders(
+    nghttp2_session* /*session*/, const nghttp2_frame* frame, void* user_data)
+{
+    if (frame->hd.type != NGHTTP2_HEADERS ||
+        frame->headers.cat != NGHTTP2_HCAT_REQUEST)
+    {
+        return 0;
+    }
+    auto  self   = static_cast<Http2Session*>(user_data);
+    auto  id     = frame->hd.stream_id;
+    auto& stream = self->streams_[id];
+    stream.con   = std::make_shared<HttpConnection>(
+        self->socket_.get_executor(), self->weak_from_this(), id,
+        self->remote_);
+
+    stream.deadline = std::chrono::steady_clock::now() + kStreamTimeout;
+    return 0;
+}
+
+int Http2Session::OnHeader(nghttp2_session* /*session*/,
+    const nghttp2_frame* frame, const uint8_t* name, size_t namelen,
+    const uint8_t* value, size_t valuelen, uint8_t /*flags*/, void* user_data)
+{
+    if (frame->hd.type != NGHTTP2_HEADERS ||
+        frame->headers.cat != NGHTTP2_HCAT_REQUEST)
+    {
+        return 0;
+    }
+    auto self = static_cast<Http2Session*>(user_data);
+    auto it   = self->streams_.find(frame->hd.stream_id);
+    if (it == self->streams_.end())
+    {
+        return 0;
+    }
+
+    auto&              request = it->second.con->request_;
+    std::string_view   key((const char*)name, namelen);
+    beast::string_view val((const char*)value, valuelen);
+    if (key == ":method")
+    {
+        request.method_string(val);
+    }
+    else if (key == ":path")
+    {
+        request.target(val);
+    }
+    else if (key == ":authority")
+    {
+        request.set(http::field::host, val);
+    }
+    else if (key.empty() || key[0] != ':')
+    {
+        request.insert(beast::string_view(key.data(), key.size()), val);
+    }
+    return 0;
+}
+
+int Http2Session::OnDataChunk(nghttp2_session* /*session*/, uint8_t /*flags*/,
+    int32_t stream_id, const uint8_t* data, size_t len, void* user_data)
+{
+    auto self = static_cast<Http2Session*>(user_data);
+    auto it   = self->streams_.find(stream_id);
+    if (it == self->streams_.end() || it->second.too_large)
+    {
+        return 0;
+    }
+
+    auto& stream = it->second;
+    auto& body   = stream.con->request_.body();
+    if (body.size() + len > self->body_limit_)
+    {
+        // 不再接收剩余的请求体, 直接回 413
+        LOG_WARN("Http2 body exceeds limit: {}", self->body_limit_);
+        stream.too_large = true;
+        stream.con->SendErrorResponse(
+            http::status::payload_too_large, "request body too large\r\n");
+        return 0;
+    }
+    body.append((const char*)data, len);
+    return 0;
+}
+
+int Http2Session::OnFrameRecv(
+    nghttp2_session* /*session*/, const nghttp2_frame* frame, void* user_data)
+{
+    if ((frame->hd.type != NGHTTP2_HEADERS &&
+            frame->hd.type != NGHTTP2_DATA) ||
+        !(frame->hd.flags & NGHTTP2_FLAG_END_STREAM))
+    {
+        return 0;
+    }
+    auto self = static_cast<Http2Session*>(user_data);
+    auto it   = self->streams_.find(frame->hd.stream_id);
+    if (it == self->streams_.end() || it->second.too_large)
+    {
+        return 0;
+    }
+    // 请求接收完毕, 与 HTTP/1.1 一样交给路由
+    it->second.con->HandleReq();
+    return 0;
+}
+
+int Http2Session::OnFrameSend(
+    nghttp2_session* session, const nghttp2_frame* frame, void* user_data)
+{
+    if (!(frame->hd.flags & NGHTTP2_FLAG_END_STREAM))
+    {
+        return 0;
+    }
+    auto self = static_cast<Http2Session*>(user_data);
+    auto it   = self->streams_.find(frame->hd.stream_id);
+    if (it == self->streams_.end() || !it->second.too_large)
+    {
+        return 0;
+    }
+    // 413 已经发完而客户端还在发送请求体, 用 NO_ERROR 重置流让它停止发送
+    if (!nghttp2_session_get_stream_remote_close(session, frame->hd.stream_id))
+    {
+        nghttp2_submit_rst_stream(session, NGHTTP2_FLAG_NONE,
+            frame->hd.stream_id, NGHTTP2_NO_ERROR);
+    }
+    return 0;
+}
+
+int Http2Session::OnStreamClose(nghttp2_session* /*session*/, int32_t stream_id,
+    uint32_t /*error_code*/, void* user_data)
+{
+    auto self = static_cast<Http2Session*>(user_data);
+    auto it   = self->streams_.find(stream_id);
+    if (it != self->streams_.end())
+    {
+        // 响应已发完或被客户端取消, 不再计入在途请求
+        it->second.con->in_flight_.reset();
+        self->streams_.erase(it);
+    }
+    return 0;
+}
+
+ssize_t Http2Session::ReadBody(nghttp2_session* /*session*/, int32_t stream_id,
+    uint8_t* buf, size_t length, uint32_t* data_flags,
+    nghttp2_data_source* /*source*/, void* user_data)
+{
+    auto self = static_cast<Http2Session*>(user_data);
+    auto it   = self->streams_.find(stream_id);
+    if (it == self->streams_.end())
+    {
+        return NGHTTP2_ERR_TEMPORAL_CALLBACK_FAILURE;
+    }
+
+    auto&       stream = it->second;
+    const auto& body   = stream.con->response_.body();
+    size_t      len    = std::min(length, body.size() - stream.sent);
+    std::memcpy(buf, body.data() + stream.sent, len);
+    stream.sent += len;
+    if (stream.sent == body.size())
+    {
+        *data_flags |= NGHTTP2_DATA_FLAG_EOF;
+    }
+    return len;
+}
+
+#endif  // GATESERVER_HTTP2
@@ -0,0 +1,96 @@
+#pragma once
+
+// 编译时找到 nghttp2 才会定义 GATESERVER_HTTP2, 否则只提供 HTTP/1.1
+#ifdef GATESERVER_HTTP2
+
+#include <array>
+#include <boost/asio.hpp>
+#include <chrono>
+#include <memory>
+#include <nghttp2/nghttp2.h>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace net = boost::asio;           // from <boost/asio.hpp>
+using tcp     = boost::asio::ip::tcp;  // from <boost/asio/ip/tcp.hpp>
+
+class HttpConnection;
+
+// h2c 连接, 客户端以 prior knowledge 方式直接发送 HTTP/2 连接序言
+// 每个流对应一个 HttpConnection 作为请求上下文, 与 HTTP/1.1 共用路由和处理函数
+class Http2Session : public std::enable_shared_from_this<Http2Session>
+{
+  public:
+    // 客户端连接序言, 用于在新连接上识别 h2c
+    static constexpr std::string_view kPreface =
+        "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+
+    Http2Session(tcp::socket socket, std::chrono::seconds idle_timeout,
+        uint64_t body_limit);
+    ~Http2Session();
+
+    // initial 为识别协议时已经读到的数据
+    void Start(std::string_view initial);
+
+    // 流的处理函数完成后调用, 需在连接所在的 io 线程中执行
+    void SubmitResponse(int32_t stream_id);
+
+  private:
+    struct Stream
+    {
+        std::shared_ptr<HttpConnection> con;
+        // 超过此时间仍未提交响应则重置流, 与 HTTP/1.1 的请求超时一致
+        std::chrono::steady_clock::time_point deadline;
+        // 响应体已交给 nghttp2 的字节数
+        size_t sent      = 0;
+        bool   too_large = false;
+        bool   responded = false;
+    };
+
+    static int OnBeginHeaders(
+        nghttp2_session* session, const nghttp2_frame* frame, void* user_data);
+    static int OnHeader(nghttp2_session* session, const nghttp2_frame* frame,
+        const uint8_t* name, size_t namelen, const uint8_t* value,
+        size_t valuelen, uint8_t flags, void* user_data);
+    static int OnDataChunk(nghttp2_session* session, uint8_t flags,
+        int32_t stream_id, const uint8_t* data, size_t len, void* user_data);
+    static int OnFrameRecv(
+        nghttp2_session* session, const nghttp2_frame* frame, void* user_data);
+    static int OnFrameSend(
+        nghttp2_session* session, const nghttp2_frame* frame, void* user_data);
+    static int OnStreamClose(nghttp2_session* session, int32_t stream_id,
+        uint32_t error_code, void* user_data);
+    static ssize_t ReadBody(nghttp2_session* session, int32_t stream_id,
+        uint8_t* buf, size_t length, uint32_t* data_flags,
+        nghttp2_data_source* source, void* user_data);
+
+    bool Receive(const char* data, size_t len);
+    void DoRead();
+    // 取出 nghttp2 待发送的帧写到 socket, 同一时间只有一个写操作
+    void DoWrite();
+    void CheckDeadline();
+    // 每秒检查一次处理超时的流
+    void CheckStreams();
+    void Close();
+
+    tcp::socket       socket_;
+    net::steady_timer deadline_;
+    net::steady_timer stream_timer_;
+    nghttp2_session*  session_ = nullptr;
+    net::ip::address  remote_;
+
+    std::array<char, 8192> read_buf_;
+    std::string            write_buf_;
+    bool                   writing_     = false;
+    bool                   receiving_   = false;
+    bool                   closed_      = false;
+    bool                   goaway_sent_ = false;
+
+    std::chrono::seconds idle_timeout_;
+    uint64_t             body_limit_;
+
+    std::unordered_map<int32_t, Stream> streams_;
+};
+
+#endif  // GATESERVER_HTTP2
@@ -1,78 +1,131 @@
 #include "HttpConnection.h"
+#include "Http2Session.h"
 #include "Logger.h"
 #include "LogicSystem.h"
 
-namespace
-{
-// 工具函数
-unsigned char ToHex(unsigned char x) { return x > 9 ? x + 55 : x + 48; }
-unsigned char FromHex(unsigned char x)
-{
-    if (x >= 'A' && x <= 'Z')
-        return x - 'A' + 10;
-    if (x >= 'a' && x <= 'z')
-        return x - 'a' + 10;
-    if (x >= '0' && x <= '9')
-        return x - '0';
-    assert(0);
-    return 0;
-}
-std::string UrlEncode(const std::string& str)
+HttpConnection::HttpConnection(boost::asio::io_context& ioc,
+    std::chrono::seconds keep_alive_timeout, int max_keep_alive_requests,
+    uint64_t body_limit, bool http2)
+    : socket_(ioc),
+      keep_alive_timeout_(keep_alive_timeout),
+      max_keep_alive_requests_(max_keep_alive_requests),
+      body_limit_(body_limit),
+      http2_(http2)
+{}
+
+HttpConnection::HttpConnection(const net::any_io_executor& executor,
+    std::weak_ptr<Http2Session> session, int32_t stream_id,
+    const net::ip::address& remote)
+    : socket_(executor),
+      remote_(remote),
+      keep_alive_timeout_(0),
+      max_keep_alive_requests_(0),
+      body_limit_(0),
+      h2_session_(std::move(session)),
+      stream_id_(stream_id)
+{}
+
+void HttpConnection::Start()
 {
-    std::string strTemp;
-    for (auto ch : str)
+    beast::error_code ec;
+    remote_ = socket_.remote_endpoint(ec).address();
+#ifdef GATESERVER_HTTP2
+    if (http2_)
     {
-        if (isalnum((unsigned char)ch) || ch == '-' || ch == '_' || ch == '.' ||
-            ch == '~')
-            strTemp += ch;
-        else if (ch == ' ')
-            strTemp += "+";
-        else
-        {
-            strTemp += '%';
-            strTemp += ToHex((unsigned char)ch >> 4);
-            strTemp += ToHex((unsigned char)ch & 0x0F);
-        }
+        deadline_.expires_after(keep_alive_timeout_);
+        CheckDeadline();
+        DetectPreface();
+        return;
     }
-    return strTemp;
+#endif
+    DoRead();
 }
-std::string UrlDecode(const std::string& str)
+
+#ifdef GATESERVER_HTTP2
+void HttpConnection::DetectPreface()
 {
-    std::string strTemp;
-    for (size_t i = 0; i < str.length(); ++i)
-    {
-        if (str[i] == '+')
-            strTemp += ' ';
-        else if (str[i] == '%')
-        {
-            assert(i + 2 < str.length());
-            unsigned char high = FromHex((unsigned char)str[++i]);
-            unsigned char low  = FromHex((unsigned char)str[++i]);
-            strTemp += high * 16 + low;
-        }
-        else
-            strTemp += str[i];
-    }
-    return strTemp;
+    auto self = shared_from_this();
+    socket_.async_read_some(buffer_.prepare(1024),
+        [self](beast::error_code ec, std::size_t bytes) {
+            if (ec)
+            {
+                self->socket_.close(ec);
+                self->deadline_.cancel();
+                return;
+            }
+            self->buffer_.commit(bytes);
+            auto             buf = self->buffer_.data();
+            std::string_view data((const char*)buf.data(), buf.size());
+            auto             preface = Http2Session::kPreface;
+            size_t           len     = std::min(data.size(), preface.size());
+            if (data.substr(0, len) != preface.substr(0, len))
+            {
+                // 已读到的数据留在 buffer_ 中, 由 HTTP/1.1 解析器继续消费
+                self->DoRead();
+                return;
+            }
+            if (data.size() < preface.size())
+            {
+                self->DetectPreface();
+                return;
+            }
+            // 连接交给 Http2Session, 本对象随之释放
+            self->deadline_.cancel();
+            auto session = std::make_shared<Http2Session>(
+                std::move(self->socket_), self->keep_alive_timeout_,
+                self->body_limit_);
+            session->Start(data);
+        });
 }
-}  // namespace
-
-HttpConnection::HttpConnection(boost::asio::io_context& ioc) : socket_(ioc) {}
+#endif
 
-void HttpConnection::Start()
+void HttpConnection::DoRead()
 {
+    // 复用 buffer_ 与请求/响应对象，buffer_ 中残留的流水线请求由下次读取消费
+    request_  = {};
+    response_ = {};
+    path_     = {};
+    path_params_.clear();
+    query_.Clear();
+    parser_.emplace();
+    parser_->body_limit(body_limit_);
+
+    // 等待请求期间按空闲超时计时，首个请求同样适用
+    deadline_.expires_after(keep_alive_timeout_);
+    CheckDeadline();
+
     auto self = shared_from_this();
     http::async_read(
-        socket_, buffer_, request_, [self](beast::error_code ec, std::size_t) {
+        socket_, buffer_, *parser_, [self](beast::error_code ec, std::size_t) {
             try
             {
+                if (ec == http::error::body_limit)
+                {
+                    self->RejectBodyTooLarge();
+                    return;
+                }
+                if (ec == http::error::end_of_stream)
+                {
+                    // 对端关闭了长连接
+                    self->socket_.shutdown(tcp::socket::shutdown_send, ec);
+                    self->deadline_.cancel();
+                    return;
+                }
                 if (ec)
                 {
-                    LOG_ERROR("Http read err, {}", ec.message());
+                    if (ec != net::error::operation_aborted)
+                    {
+                        LOG_ERROR("Http read err, {}", ec.message());
+                    }
+                    self->socket_.close(ec);
+                    self->deadline_.cancel();
                     return;
                 }
-                self->HandleReq();
+                // 处理与回包阶段使用固定的请求超时
+                self->deadline_.expires_after(std::chrono::seconds(60));
                 self->CheckDeadline();
+                self->request_ = self->parser_->release();
+                self->HandleReq();
             }
             catch (std::exception& exp)
             {
@@ -81,47 +134,53 @@ void HttpConnection::Start()
         });
 }
 
+void HttpConnection::RejectBodyTooLarge()
+{
+    // 剩余的请求体不再解析, 回 413 后丢弃输入直到对端关闭
+    LOG_WARN("Http body exceeds limit: {}", body_limit_);
+    deadline_.expires_after(std::chrono::seconds(60));
+    CheckDeadline();
+    response_.version(parser_->get().version());
+    response_.keep_alive(false);
+    response_.set(http::field::server, "GateServer");
+    SendErrorResponse(
+        http::status::payload_too_large, "request body too large\r\n");
+}
+
 void HttpConnection::HandleReq()
 {
+    ++handled_requests_;
     response_.version(request_.version());
-    response_.keep_alive(false);
+    response_.keep_alive(request_.keep_alive() &&
+                         handled_requests_ < max_keep_alive_requests_ &&
+                         !LogicSystem::GetInstance()->Draining());
     response_.set(boost::beast::http::field::access_control_allow_origin, "*");
 
-    switch (request_.method())
+    ParseTarget();
+    response_.result(http::status::ok);
+    response_.set(http::field::server, "GateServer");
+    // 处理函数完成后经 CompleteResponse 写回
+    auto status = LogicSystem::GetInstance()->HandleRequest(shared_from_this());
+    if (status == http::status::method_not_allowed)
     {
-        case http::verb::get: HandleGetRequest(); break;
-        case http::verb::post: HandlePostRequest(); break;
-        default:
-            SendErrorResponse(
-                http::status::bad_request, "Unsupported HTTP method");
-            break;
+        SendErrorResponse(status, "Unsupported HTTP method\r\n");
     }
-}
-
-void HttpConnection::HandleGetRequest()
-{
-    PreParseGetParam();
-    if (!LogicSystem::GetInstance()->HandleGet(url_, shared_from_this()))
+    else if (status != http::status::ok)
     {
-        SendErrorResponse(http::status::not_found, "url not found\r\n");
-        return;
+        SendErrorResponse(status, "url not found\r\n");
     }
-    response_.result(http::status::ok);
-    response_.set(http::field::server, "GateServer");
-    WriteResponse();
 }
 
-void HttpConnection::HandlePostRequest()
+std::string_view HttpConnection::PathParam(std::string_view name) const
 {
-    if (!LogicSystem::GetInstance()->HandlePost(
-            request_.target(), shared_from_this()))
+    for (auto& param : path_params_)
     {
-        SendErrorResponse(http::status::not_found, "url not found\r\n");
-        return;
+        if (param.first == name)
+        {
+            return param.second;
+        }
     }
-    response_.result(http::status::ok);
-    response_.set(http::field::server, "GateServer");
-    WriteResponse();
+    return {};
 }
 
 void HttpConnection::SendErrorResponse(
@@ -129,41 +188,25 @@ void HttpConnection::SendErrorResponse(
 {
     response_.result(status);
     response_.set(http::field::content_type, "text/plain");
-    beast::ostream(response_.body()) << message;
+    response_.body().append(message);
     WriteResponse();
 }
 
-void HttpConnection::PreParseGetParam()
+void HttpConnection::CompleteResponse()
 {
-    auto uri       = request_.target();
-    auto query_pos = uri.find('?');
-    if (query_pos == std::string::npos)
-    {
-        url_ = uri;
-        return;
-    }
-    url_                     = uri.substr(0, query_pos);
-    std::string query_string = uri.substr(query_pos + 1);
-    size_t      pos          = 0;
-    while ((pos = query_string.find('&')) != std::string::npos)
-    {
-        auto   pair   = query_string.substr(0, pos);
-        size_t eq_pos = pair.find('=');
-        if (eq_pos != std::string::npos)
-        {
-            params_[UrlDecode(pair.substr(0, eq_pos))] =
-                UrlDecode(pair.substr(eq_pos + 1));
-        }
-        query_string.erase(0, pos + 1);
-    }
-    if (!query_string.empty())
+    auto self = shared_from_this();
+    net::post(socket_.get_executor(), [self]() { self->WriteResponse(); });
+}
+
+void HttpConnection::ParseTarget()
+{
+    auto             target = request_.target();
+    std::string_view uri(target.data(), target.size());
+    auto             query_pos = uri.find('?');
+    path_                      = uri.substr(0, query_pos);
+    if (query_pos != std::string_view::npos)
     {
-        size_t eq_pos = query_string.find('=');
-        if (eq_pos != std::string::npos)
-        {
-            params_[UrlDecode(query_string.substr(0, eq_pos))] =
-                UrlDecode(query_string.substr(eq_pos + 1));
-        }
+        query_.Parse(uri.substr(query_pos + 1));
     }
 }
 
@@ -171,6 +214,7 @@ void HttpConnection::CheckDeadline()
 {
     auto self = shared_from_this();
     deadline_.async_wait([self](beast::error_code ec) {
+        // 重新设置超时会取消之前的等待，此时 ec 为 operation_aborted
         if (!ec)
         {
             self->socket_.close(ec);
@@ -180,18 +224,65 @@ void HttpConnection::CheckDeadline()
 
 void HttpConnection::WriteResponse()
 {
+    if (stream_id_ != 0)
+    {
+#ifdef GATESERVER_HTTP2
+        if (auto session = h2_session_.lock())
+        {
+            // 流关闭时由 Http2Session 释放在途计数
+            session->SubmitResponse(stream_id_);
+            return;
+        }
+#endif
+        in_flight_.reset();
+        return;
+    }
+
     auto self = shared_from_this();
     response_.content_length(response_.body().size());
     http::async_write(
         socket_, response_, [self](beast::error_code ec, std::size_t) {
+            self->in_flight_.reset();
             if (ec)
             {
                 self->socket_.close(ec);
+                self->deadline_.cancel();
+                return;
             }
-            else
+            if (self->response_.keep_alive())
             {
-                self->socket_.shutdown(tcp::socket::shutdown_send, ec);
+                self->DoRead();
+                return;
             }
-            self->deadline_.cancel();
+            self->LingerClose();
         });
 }
+
+void HttpConnection::LingerClose()
+{
+    // 接收缓冲区中还有未读数据(如 413 时剩余的请求体)时直接关闭会发出 RST,
+    // 客户端可能因此丢掉已经收到的响应
+    beast::error_code ec;
+    socket_.shutdown(tcp::socket::shutdown_send, ec);
+    buffer_.clear();
+    deadline_.expires_after(std::chrono::seconds(5));
+    CheckDeadline();
+    DiscardInput();
+}
+
+void HttpConnection::DiscardInput()
+{
+    // 读到的数据不 commit, 直接覆盖
+    auto self = shared_from_this();
+    auto buf  = buffer_.prepare(buffer_.max_size());
+    socket_.async_read_some(buf, [self](beast::error_code ec, std::size_t) {
+        if (ec)
+        {
+            // 对端关闭, 或超时后 socket 已被关闭
+            self->socket_.close(ec);
+            self->deadline_.cancel();
+            return;
+        }
+        self->DiscardInput();
+    });
+}
@@ -3,44 +3,89 @@
 #include <boost/asio.hpp>
 #include <boost/beast.hpp>
 #include <boost/beast/http.hpp>
+#include <optional>
+#include <string_view>
+
+#include "Router.h"
 
 namespace beast = boost::beast;          // from <boost/beast.hpp>
 namespace http  = beast::http;           // from <boost/beast/http.hpp>
 namespace net   = boost::asio;           // from <boost/asio.hpp>
 using tcp       = boost::asio::ip::tcp;  // from <boost/asio/ip/tcp.hpp>
 
+class Http2Session;
+
 class HttpConnection : public std::enable_shared_from_this<HttpConnection>
 {
     friend class LogicSystem;
+    friend class Http2Session;
 
   public:
-    HttpConnection(boost::asio::io_context& ioc);
+    HttpConnection(boost::asio::io_context& ioc,
+        std::chrono::seconds keep_alive_timeout, int max_keep_alive_requests,
+        uint64_t body_limit, bool http2);
+    // HTTP/2 流的请求上下文, 不使用自己的 socket, 响应交给所属连接发送
+    HttpConnection(const net::any_io_executor& executor,
+        std::weak_ptr<Http2Session> session, int32_t stream_id,
+        const net::ip::address& remote);
 
     void Start();
-    void PreParseGetParam();
 
     tcp::socket& GetSocket() { return socket_; }
 
-    void HandleGetRequest();
-    void HandlePostRequest();
+    // 路由中 :name 段匹配到的值, 不存在时返回空
+    std::string_view PathParam(std::string_view name) const;
+
     void SendErrorResponse(http::status status, const std::string& message);
+    // 业务线程处理完毕后调用, 切回连接所在的 io 线程写回响应
+    void CompleteResponse();
 
   private:
+#ifdef GATESERVER_HTTP2
+    // 读取开头的数据判断是否为 h2c 连接序言, 不是则按 HTTP/1.1 处理
+    void DetectPreface();
+#endif
+    void DoRead();
     void CheckDeadline();
     void WriteResponse();
     void HandleReq();
+    void RejectBodyTooLarge();
+    // 不再保持连接时先关闭写方向, 丢弃对端剩余数据直到对端关闭或超时
+    void LingerClose();
+    void DiscardInput();
+    // 将 target 切分为路径与查询串, 只记录 string_view 不做拷贝
+    void ParseTarget();
 
-    tcp::socket socket_;
+    tcp::socket      socket_;
+    net::ip::address remote_;
 
     beast::flat_buffer buffer_{8192};
 
-    http::request<http::dynamic_body> request_;
+    // 每个请求新建 parser 以限制请求体大小, 请求体直接读入 string_body
+    std::optional<http::request_parser<http::string_body>> parser_;
+    http::request<http::string_body>                       request_;
 
-    http::response<http::dynamic_body> response_;
+    // 处理函数直接往 string_body 里写 JSON, 发送时不再从 buffer 序列拷贝
+    http::response<http::string_body> response_;
 
     net::steady_timer deadline_{
         socket_.get_executor(), std::chrono::seconds(60)};
 
-    std::string                                  url_;
-    std::unordered_map<std::string, std::string> params_;
+    // 两次请求之间的空闲超时，以及单连接最多处理的请求数
+    std::chrono::seconds keep_alive_timeout_;
+    int                  max_keep_alive_requests_;
+    int                  handled_requests_{0};
+    uint64_t             body_limit_;
+    bool                 http2_{false};
+
+    // 非空时为 HTTP/2 流
+    std::weak_ptr<Http2Session> h2_session_;
+    int32_t                     stream_id_{0};
+
+    std::string_view path_;
+    PathParams       path_params_;
+    QueryParams      query_;
+
+    // 在途请求计数, 响应写完或流关闭时释放
+    std::shared_ptr<void> in_flight_;
 };
@@ -0,0 +1,328 @@
+#include "JsonFieldReader.h"
+
+namespace
+{
+// 跳过嵌套对象/数组的最大深度, 防止恶意构造的深层嵌套
+const int kMaxDepth = 32;
+
+int HexValue(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
+
+// 读取 pos 开始的 4 位十六进制数
+bool ReadHex4(std::string_view doc, size_t pos, unsigned& value)
+{
+    if (pos + 4 > doc.size())
+    {
+        return false;
+    }
+    value = 0;
+    for (size_t i = pos; i < pos + 4; ++i)
+    {
+        int v = HexValue(doc[i]);
+        if (v < 0)
+        {
+            return false;
+        }
+        value = value << 4 | v;
+    }
+    return true;
+}
+
+void AppendUtf8(std::string& out, unsigned cp)
+{
+    if (cp < 0x80)
+    {
+        out += (char)cp;
+    }
+    else if (cp < 0x800)
+    {
+        out += (char)(0xC0 | (cp >> 6));
+        out += (char)(0x80 | (cp & 0x3F));
+    }
+    else if (cp < 0x10000)
+    {
+        out += (char)(0xE0 | (cp >> 12));
+        out += (char)(0x80 | ((cp >> 6) & 0x3F));
+        out += (char)(0x80 | (cp & 0x3F));
+    }
+    else
+    {
+        out += (char)(0xF0 | (cp >> 18));
+        out += (char)(0x80 | ((cp >> 12) & 0x3F));
+        out += (char)(0x80 | ((cp >> 6) & 0x3F));
+        out += (char)(0x80 | (cp & 0x3F));
+    }
+}
+}  // namespace
+
+JsonFieldReader& JsonFieldReader::Bind(
+    std::string_view key, std::string& out, bool* found)
+{
+    if (found != nullptr)
+    {
+        *found = false;
+    }
+    fields_.push_back({key, &out, found});
+    return *this;
+}
+
+void JsonFieldReader::skipSpace()
+{
+    while (pos_ < doc_.size() && (doc_[pos_] == ' ' || doc_[pos_] == '\t' ||
+                                     doc_[pos_] == '\r' || doc_[pos_] == '\n'))
+    {
+        ++pos_;
+    }
+}
+
+bool JsonFieldReader::readString(std::string* out)
+{
+    // 调用时 pos_ 指向开头的引号, out 为空表示只跳过
+    ++pos_;
+    for (;;)
+    {
+        size_t stop = doc_.find_first_of("\"\\", pos_);
+        if (stop == std::string_view::npos)
+        {
+            return false;
+        }
+        if (out != nullptr)
+        {
+            out->append(doc_.data() + pos_, stop - pos_);
+        }
+        pos_ = stop + 1;
+        if (doc_[stop] == '"')
+        {
+            return true;
+        }
+
+        // 转义字符
+        if (pos_ >= doc_.size())
+        {
+            return false;
+        }
+        char c = doc_[pos_++];
+        if (c != 'u')
+        {
+            static const std::string_view from = "\"\\/bfnrt";
+            static const std::string_view to   = "\"\\/\b\f\n\r\t";
+            size_t                        idx  = from.find(c);
+            if (idx == std::string_view::npos)
+            {
+                return false;
+            }
+            if (out != nullptr)
+            {
+                *out += to[idx];
+            }
+            continue;
+        }
+
+        unsigned cp = 0;
+        if (!ReadHex4(doc_, pos_, cp))
+        {
+            return false;
+        }
+        pos_ += 4;
+        // 代理项必须成对出现, 单独的代理项编码后不是合法的 UTF-8, 按格式错误处理
+        if (cp >= 0xDC00 && cp <= 0xDFFF)
+        {
+            return false;
+        }
+        if (cp >= 0xD800 && cp <= 0xDBFF)
+        {
+            unsigned low = 0;
+            if (doc_.substr(pos_, 2) != "\\u" ||
+                !ReadHex4(doc_, pos_ + 2, low) || low < 0xDC00 || low > 0xDFFF)
+            {
+                return false;
+            }
+            cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+            pos_ += 6;
+        }
+        if (out != nullptr)
+        {
+            AppendUtf8(*out, cp);
+        }
+    }
+}
+
+bool JsonFieldReader::readScalar(std::string* out)
+{
+    size_t begin = pos_;
+    while (pos_ < doc_.size() && doc_[pos_] != ',' && doc_[pos_] != '}' &&
+           doc_[pos_] != ']' && doc_[pos_] != ' ' && doc_[pos_] != '\t' &&
+           doc_[pos_] != '\r' && doc_[pos_] != '\n')
+    {
+        ++pos_;
+    }
+    if (pos_ == begin)
+    {
+        return false;
+    }
+    if (out != nullptr)
+    {
+        out->assign(doc_.data() + begin, pos_ - begin);
+    }
+    return true;
+}
+
+bool JsonFieldReader::skipValue(int depth)
+{
+    if (depth > kMaxDepth)
+    {
+        return false;
+    }
+    skipSpace();
+    if (pos_ >= doc_.size())
+    {
+        return false;
+    }
+    char open = doc_[pos_];
+    if (open == '"')
+    {
+        return readString(nullptr);
+    }
+    if (open != '{' && open != '[')
+    {
+        return readScalar(nullptr);
+    }
+
+    char close = open == '{' ? '}' : ']';
+    ++pos_;
+    skipSpace();
+    if (pos_ < doc_.size() && doc_[pos_] == close)
+    {
+        ++pos_;
+        return true;
+    }
+    for (;;)
+    {
+        if (open == '{')
+        {
+            skipSpace();
+            if (pos_ >= doc_.size() || doc_[pos_] != '"' ||
+                !readString(nullptr))
+            {
+                return false;
+            }
+            skipSpace();
+            if (pos_ >= doc_.size() || doc_[pos_++] != ':')
+            {
+                return false;
+            }
+        }
+        if (!skipValue(depth + 1))
+        {
+            return false;
+        }
+        skipSpace();
+        if (pos_ >= doc_.size())
+        {
+            return false;
+        }
+        char c = doc_[pos_++];
+        if (c == close)
+        {
+            return true;
+        }
+        if (c != ',')
+        {
+            return false;
+        }
+    }
+}
+
+bool JsonFieldReader::Parse()
+{
+    pos_ = 0;
+    skipSpace();
+    if (pos_ >= doc_.size() || doc_[pos_] != '{')
+    {
+        return false;
+    }
+    ++pos_;
+    skipSpace();
+    if (pos_ < doc_.size() && doc_[pos_] == '}')
+    {
+        return true;
+    }
+
+    std::string key;
+    for (;;)
+    {
+        skipSpace();
+        key.clear();
+        if (pos_ >= doc_.size() || doc_[pos_] != '"' || !readString(&key))
+        {
+            return false;
+        }
+        skipSpace();
+        if (pos_ >= doc_.size() || doc_[pos_++] != ':')
+        {
+            return false;
+        }
+        skipSpace();
+
+        Field* field = nullptr;
+        for (auto& f : fields_)
+        {
+            if (f.key == key)
+            {
+                field = &f;
+                break;
+            }
+        }
+
+        bool ok;
+        if (field == nullptr)
+        {
+            ok = skipValue(0);
+        }
+        else if (pos_ < doc_.size() && doc_[pos_] == '"')
+        {
+            field->out->clear();
+            ok = readString(field->out);
+        }
+        else if (pos_ < doc_.size() && doc_[pos_] != '{' && doc_[pos_] != '[')
+        {
+            ok = readScalar(field->out);
+        }
+        else
+        {
+            // 绑定的字段是对象或数组, 不支持
+            ok = false;
+        }
+        if (!ok)
+        {
+            return false;
+        }
+        if (field != nullptr && field->found != nullptr)
+        {
+            *field->found = true;
+        }
+
+        skipSpace();
+        if (pos_ >= doc_.size())
+        {
+            return false;
+        }
+        char c = doc_[pos_++];
+        if (c == '}')
+        {
+            return true;
+        }
+        if (c != ',')
+        {
+            return false;
+        }
+    }
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+// 固定格式请求体的轻量解析
+// 顺序扫描顶层对象, 只取出绑定了的字符串字段, 其余值直接跳过, 不构建 DOM
+// 数字、布尔等非字符串值按原文写入绑定的字段
+class JsonFieldReader
+{
+  public:
+    explicit JsonFieldReader(std::string_view doc) : doc_(doc), pos_(0) {}
+
+    // 字段缺失时 out 保持不变, found 为 false
+    JsonFieldReader& Bind(
+        std::string_view key, std::string& out, bool* found = nullptr);
+
+    // 文档不是合法的 JSON 对象时返回 false
+    bool Parse();
+
+  private:
+    struct Field
+    {
+        std::string_view key;
+        std::string*     out;
+        bool*            found;
+    };
+
+    void skipSpace();
+    bool readString(std::string* out);
+    bool skipValue(int depth);
+    bool readScalar(std::string* out);
+
+    std::string_view   doc_;
+    size_t             pos_;
+    std::vector<Field> fields_;
+};
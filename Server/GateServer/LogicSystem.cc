@@ -1,5 +1,8 @@
 #include "LogicSystem.h"
+#include "ConfigMgr.h"
 #include "HttpConnection.h"
+#include "JsonFieldReader.h"
+#include "JsonWriter.h"
 #include "Logger.h"
 #include "MysqlMgr.h"
 #include "RedisMgr.h"
@@ -10,79 +13,115 @@
 #include <jsoncpp/json/reader.h>
 #include <jsoncpp/json/value.h>
 
+namespace
+{
+// 回包字段名, 启动时拼好
+const JsonKey kError("error");
+const JsonKey kEmail("email");
+const JsonKey kUid("uid");
+const JsonKey kUser("user");
+const JsonKey kPasswd("passwd");
+const JsonKey kConfirm("confirm");
+const JsonKey kIcon("icon");
+const JsonKey kVarifyCode("varifycode");
+const JsonKey kToken("token");
+const JsonKey kHost("host");
+const JsonKey kPort("port");
+
+// 只带错误码的回包
+void WriteError(std::string& body, int error)
+{
+    JsonWriter(body).BeginObject().Field(kError, error).EndObject();
+}
+
+// 由连接持有到响应写完, 析构时减少在途请求数
+struct InFlightGuard
+{
+    explicit InFlightGuard(std::atomic<int>& count) : count_(count)
+    {
+        ++count_;
+    }
+    ~InFlightGuard() { --count_; }
+
+    std::atomic<int>& count_;
+};
+}  // namespace
+
 LogicSystem::LogicSystem()
 {
+    auto& cfg         = ConfigMgr::Inst();
+    auto  threads     = cfg["GateServer"]["HandlerThreads"];
+    auto  queue_size  = cfg["GateServer"]["HandlerQueueSize"];
+    auto  deadline_ms = cfg["GateServer"]["HandlerDeadline"];
+
+    // 只限制排队时间, 处理函数内的 grpc 调用各自设置 deadline
+    deadline_ = std::chrono::milliseconds(
+        deadline_ms.empty() ? 3000 : stoi(deadline_ms));
+    workers_.reset(new WorkerPool(threads.empty() ? 8 : stoul(threads),
+        queue_size.empty() ? 1024 : stoul(queue_size)));
+
     RegGet("/get_test", [](std::shared_ptr<HttpConnection> connection) {
-        beast::ostream(connection->response_.body())
-            << "receive get_test req " << std::endl;
+        auto& body = connection->response_.body();
+        body.append("receive get_test req \n");
         int i = 0;
-        for (auto& elem : connection->params_)
-        {
-            i++;
-            beast::ostream(connection->response_.body())
-                << "param" << i << " key is " << elem.first;
-            beast::ostream(connection->response_.body())
-                << ", " << " value is " << elem.second << std::endl;
-        }
+        connection->query_.ForEach(
+            [&](const std::string& key, const std::string& value) {
+                i++;
+                body.append("param").append(std::to_string(i));
+                body.append(" key is ").append(key);
+                body.append(",  value is ").append(value).append("\n");
+            });
 
         connection->response_.set(http::field::content_type, "text/plain");
     });
 
-    RegPost("/get_varifycode", [](std::shared_ptr<HttpConnection> connection) {
-        auto body_str =
-            boost::beast::buffers_to_string(connection->request_.body().data());
-        LOG_INFO("Request target:{} receive: {}", connection->request_.target(),
-                 body_str);
-        connection->response_.set(http::field::content_type, "text/json");
-        Json::Value  root;
-        Json::Reader reader;
-        Json::Value  src_root;
-        bool         parse_success = reader.parse(body_str, src_root);
-        if (!parse_success)
-        {
-            LOG_ERROR("Failed to parse JSON data");
-            root["error"]       = ErrorCodes::Error_Json;
-            std::string jsonstr = root.toStyledString();
-            beast::ostream(connection->response_.body()) << jsonstr;
-            return true;
-        }
+    RegPostAsync("/get_varifycode",
+        [](std::shared_ptr<HttpConnection> connection, HttpDone done) {
+            const auto& body_str = connection->request_.body();
+            LOG_INFO("Request target:{} receive: {}",
+                     connection->request_.target(), body_str);
+            connection->response_.set(http::field::content_type, "text/json");
+            // 固定格式的请求只取需要的字段, 不构建 DOM
+            std::string     email;
+            bool            has_email = false;
+            JsonFieldReader fields(body_str);
+            bool            parse_success =
+                fields.Bind("email", email, &has_email).Parse();
+            if (!parse_success || !has_email)
+            {
+                LOG_ERROR("Failed to parse JSON data");
+                WriteError(connection->response_.body(),
+                    ErrorCodes::Error_Json);
+                done();
+                return;
+            }
 
-        if (!src_root.isMember("email"))
-        {
-            LOG_ERROR("Failed to parse JSON data");
-            root["error"]       = ErrorCodes::Error_Json;
-            std::string jsonstr = root.toStyledString();
-            beast::ostream(connection->response_.body()) << jsonstr;
-            return true;
-        }
-
-        auto         email = src_root["email"].asString();
-        GetVarifyRsp rsp =
-            VerifyGrpcClient::GetInstance()->GetVarifyCode(email);
-        cout << "email is " << email << endl;
-        root["error"]       = rsp.error();
-        root["email"]       = src_root["email"];
-        std::string jsonstr = root.toStyledString();
-        beast::ostream(connection->response_.body()) << jsonstr;
-        return true;
-    });
+            LOG_INFO("email is {}", email);
+            VerifyGrpcClient::GetInstance()->GetVarifyCodeAsync(
+                email, [connection, done, email](const GetVarifyRsp& rsp) {
+                    JsonWriter(connection->response_.body())
+                        .BeginObject()
+                        .Field(kError, rsp.error())
+                        .Field(kEmail, email)
+                        .EndObject();
+                    done();
+                });
+        });
 
     RegPost("/user_register", [](std::shared_ptr<HttpConnection> connection) {
-        auto body_str =
-            boost::beast::buffers_to_string(connection->request_.body().data());
+        const auto& body_str = connection->request_.body();
         LOG_INFO("Request target:{} receive: {}", connection->request_.target(),
                  body_str);
         connection->response_.set(http::field::content_type, "text/json");
-        Json::Value  root;
         Json::Reader reader;
         Json::Value  src_root;
-        bool         parse_success = reader.parse(body_str, src_root);
+        // 直接在请求体上解析, 避免 parse(std::string) 内部的拷贝
+        bool parse_success = reader.parse(
+            body_str.data(), body_str.data() + body_str.size(), src_root);
         if (!parse_success)
         {
             LOG_ERROR("Failed to parse JSON data");
-            root["error"]       = ErrorCodes::Error_Json;
-            std::string jsonstr = root.toStyledString();
-            beast::ostream(connection->response_.body()) << jsonstr;
+            WriteError(connection->response_.body(), ErrorCodes::Error_Json);
             return true;
         }
 
@@ -95,9 +134,7 @@ LogicSystem::LogicSystem()
         if (pwd != confirm)
         {
             LOG_ERROR("password not match");
-            root["error"]       = ErrorCodes::PasswdErr;
-            std::string jsonstr = root.toStyledString();
-            beast::ostream(connection->response_.body()) << jsonstr;
+            WriteError(connection->response_.body(), ErrorCodes::PasswdErr);
             return true;
         }
 
@@ -108,18 +145,14 @@ LogicSystem::LogicSystem()
         if (!b_get_varify)
         {
             LOG_INFO("get varify code expired");
-            root["error"]       = ErrorCodes::VarifyExpired;
-            std::string jsonstr = root.toStyledString();
-            beast::ostream(connection->response_.body()) << jsonstr;
+            WriteError(connection->response_.body(), ErrorCodes::VarifyExpired);
             return true;
         }
 
         if (varify_code != src_root["varifycode"].asString())
         {
             LOG_INFO("varify code error");
-            root["error"]       = ErrorCodes::VarifyCodeErr;
-            std::string jsonstr = root.toStyledString();
-            beast::ostream(connection->response_.body()) << jsonstr;
+            WriteError(connection->response_.body(), ErrorCodes::VarifyCodeErr);
             return true;
         }
 
@@ -128,41 +161,38 @@ LogicSystem::LogicSystem()
         if (uid == 0 || uid == -1)
         {
             LOG_INFO("user or email exist");
-            root["error"]       = ErrorCodes::UserExist;
-            std::string jsonstr = root.toStyledString();
-            beast::ostream(connection->response_.body()) << jsonstr;
+            WriteError(connection->response_.body(), ErrorCodes::UserExist);
             return true;
         }
-        root["error"]       = 0;
-        root["uid"]         = uid;
-        root["email"]       = email;
-        root["user"]        = name;
-        root["passwd"]      = pwd;
-        root["confirm"]     = confirm;
-        root["icon"]        = icon;
-        root["varifycode"]  = src_root["varifycode"].asString();
-        std::string jsonstr = root.toStyledString();
-        beast::ostream(connection->response_.body()) << jsonstr;
+        JsonWriter(connection->response_.body())
+            .BeginObject()
+            .Field(kError, 0)
+            .Field(kUid, uid)
+            .Field(kEmail, email)
+            .Field(kUser, name)
+            .Field(kPasswd, pwd)
+            .Field(kConfirm, confirm)
+            .Field(kIcon, icon)
+            .Field(kVarifyCode, src_root["varifycode"].asString())
+            .EndObject();
         return true;
     });
 
     // 重置回调逻辑
     RegPost("/reset_pwd", [](std::shared_ptr<HttpConnection> connection) {
-        auto body_str =
-            boost::beast::buffers_to_string(connection->request_.body().data());
+        const auto& body_str = connection->request_.body();
         LOG_INFO("Request target:{} receive: {}", connection->request_.target(),
                  body_str);
         connection->response_.set(http::field::content_type, "text/json");
-        Json::Value  root;
         Json::Reader reader;
         Json::Value  src_root;
-        bool         parse_success = reader.parse(body_str, src_root);
+        // 直接在请求体上解析, 避免 parse(std::string) 内部的拷贝
+        bool parse_success = reader.parse(
+            body_str.data(), body_str.data() + body_str.size(), src_root);
         if (!parse_success)
         {
             LOG_ERROR("Failed to parse JSON data");
-            root["error"]       = ErrorCodes::Error_Json;
-            std::string jsonstr = root.toStyledString();
-            beast::ostream(connection->response_.body()) << jsonstr;
+            WriteError(connection->response_.body(), ErrorCodes::Error_Json);
             return true;
         }
 
@@ -177,28 +207,24 @@ LogicSystem::LogicSystem()
         if (!b_get_varify)
         {
             LOG_INFO("get varify code expired");
-            root["error"]       = ErrorCodes::VarifyExpired;
-            std::string jsonstr = root.toStyledString();
-            beast::ostream(connection->response_.body()) << jsonstr;
+            WriteError(connection->response_.body(), ErrorCodes::VarifyExpired);
             return true;
         }
 
         if (varify_code != src_root["varifycode"].asString())
         {
             LOG_INFO("varify code error");
-            root["error"]       = ErrorCodes::VarifyCodeErr;
-            std::string jsonstr = root.toStyledString();
-            beast::ostream(connection->response_.body()) << jsonstr;
+            WriteError(connection->response_.body(), ErrorCodes::VarifyCodeErr);
             return true;
         }
         // 查询数据库判断用户名和邮箱是否匹配
-        bool email_valid = MysqlMgr::GetInstance()->CheckEmail(name, email);
+        // 校验结果决定是否写库, 读主库避免从库延迟
+        bool email_valid =
+            MysqlMgr::GetInstance()->CheckEmail(name, email, true);
         if (!email_valid)
         {
             LOG_INFO("user email not match");
-            root["error"]       = ErrorCodes::EmailNotMatch;
-            std::string jsonstr = root.toStyledString();
-            beast::ostream(connection->response_.body()) << jsonstr;
+            WriteError(connection->response_.body(), ErrorCodes::EmailNotMatch);
             return true;
         }
 
@@ -207,115 +233,251 @@ LogicSystem::LogicSystem()
         if (!b_up)
         {
             LOG_INFO("update password failed");
-            root["error"]       = ErrorCodes::PasswdUpFailed;
-            std::string jsonstr = root.toStyledString();
-            beast::ostream(connection->response_.body()) << jsonstr;
+            WriteError(connection->response_.body(),
+                ErrorCodes::PasswdUpFailed);
             return true;
         }
         LOG_INFO("update password succeed");
-        root["error"]       = 0;
-        root["email"]       = email;
-        root["user"]        = name;
-        root["passwd"]      = pwd;
-        root["varifycode"]  = src_root["varifycode"].asString();
-        std::string jsonstr = root.toStyledString();
-        beast::ostream(connection->response_.body()) << jsonstr;
+        JsonWriter(connection->response_.body())
+            .BeginObject()
+            .Field(kError, 0)
+            .Field(kEmail, email)
+            .Field(kUser, name)
+            .Field(kPasswd, pwd)
+            .Field(kVarifyCode, src_root["varifycode"].asString())
+            .EndObject();
         return true;
     });
 
-    // 用户登录逻辑
-    RegPost("/user_login", [](std::shared_ptr<HttpConnection> connection) {
-        auto body_str =
-            boost::beast::buffers_to_string(connection->request_.body().data());
-        LOG_INFO("Request target:{} receive: {}", connection->request_.target(),
-                 body_str);
-        connection->response_.set(http::field::content_type, "text/json");
-        Json::Value  root;
-        Json::Reader reader;
-        Json::Value  src_root;
-        bool         parse_success = reader.parse(body_str, src_root);
-        if (!parse_success)
-        {
-            LOG_ERROR("Failed to parse JSON data");
-            root["error"]       = ErrorCodes::Error_Json;
-            std::string jsonstr = root.toStyledString();
-            beast::ostream(connection->response_.body()) << jsonstr;
-            return true;
-        }
+    // 用户登录逻辑, 查库在DB线程池, 查询StatusServer走异步gRPC
+    RegPostAsync("/user_login",
+        [](std::shared_ptr<HttpConnection> connection, HttpDone done) {
+            const auto& body_str = connection->request_.body();
+            LOG_INFO("Request target:{} receive: {}",
+                     connection->request_.target(), body_str);
+            connection->response_.set(http::field::content_type, "text/json");
+            std::string email;
+            std::string pwd;
+            bool        parse_success = JsonFieldReader(body_str)
+                                     .Bind("email", email)
+                                     .Bind("passwd", pwd)
+                                     .Parse();
+            if (!parse_success)
+            {
+                LOG_ERROR("Failed to parse JSON data");
+                WriteError(connection->response_.body(),
+                    ErrorCodes::Error_Json);
+                done();
+                return;
+            }
 
-        auto     email = src_root["email"].asString();
-        auto     pwd   = src_root["passwd"].asString();
-        UserInfo userInfo;
-        // 查询数据库判断用户名和密码是否匹配
-        bool pwd_valid =
-            MysqlMgr::GetInstance()->CheckPwd(email, pwd, userInfo);
-        if (!pwd_valid)
-        {
-            LOG_INFO("user email not match");
-            root["error"]       = ErrorCodes::PasswdInvalid;
-            std::string jsonstr = root.toStyledString();
-            beast::ostream(connection->response_.body()) << jsonstr;
-            return true;
-        }
+            // 查询数据库判断用户名和密码是否匹配
+            MysqlMgr::GetInstance()->CheckPwdAsync(email, pwd,
+                [connection, done, email](int error, UserInfo& userInfo) {
+                    if (error == ErrorCodes::RPCFailed)
+                    {
+                        // DB线程池过载, 不能当作密码错误返回给用户
+                        LOG_WARN("check password dropped, db pool busy");
+                        ServerBusy(connection, done);
+                        return;
+                    }
+                    if (error != ErrorCodes::Success)
+                    {
+                        LOG_INFO("user email not match");
+                        WriteError(connection->response_.body(),
+                            ErrorCodes::PasswdInvalid);
+                        done();
+                        return;
+                    }
 
-        LOG_INFO("gRpc get chat server begin uid: {}", userInfo.uid_);
-        // 查询StatusServer找到合适的连接
-        auto reply =
-            StatusGrpcClient::GetInstance()->GetChatServer(userInfo.uid_);
-        if (reply.error())
-        {
-            LOG_ERROR("get chat server failed error: {}", reply.error());
-            root["error"]       = ErrorCodes::RPCFailed;
-            std::string jsonstr = root.toStyledString();
-            beast::ostream(connection->response_.body()) << jsonstr;
-            return true;
-        }
-        LOG_INFO("gRPC get chat server success uid: {}", userInfo.uid_);
-
-        root["error"]       = 0;
-        root["email"]       = email;
-        root["uid"]         = userInfo.uid_;
-        root["token"]       = reply.token();
-        root["host"]        = reply.host();
-        root["port"]        = reply.port();
-        std::string jsonstr = root.toStyledString();
-        beast::ostream(connection->response_.body()) << jsonstr;
-        return true;
-    });
+                    int uid = userInfo.uid_;
+                    LOG_INFO("gRpc get chat server begin uid: {}", uid);
+                    // 查询StatusServer找到合适的连接
+                    StatusGrpcClient::GetInstance()->GetChatServerAsync(uid,
+                        [connection, done, email, uid](
+                            const GetChatServerRsp& reply) {
+                            if (reply.error())
+                            {
+                                LOG_ERROR("get chat server failed error: {}",
+                                          reply.error());
+                                WriteError(connection->response_.body(),
+                                    ErrorCodes::RPCFailed);
+                                done();
+                                return;
+                            }
+                            LOG_INFO("gRPC get chat server success uid: {}",
+                                     uid);
+                            JsonWriter(connection->response_.body())
+                                .BeginObject()
+                                .Field(kError, 0)
+                                .Field(kEmail, email)
+                                .Field(kUid, uid)
+                                .Field(kToken, reply.token())
+                                .Field(kHost, reply.host())
+                                .Field(kPort, reply.port())
+                                .EndObject();
+                            done();
+                        });
+                });
+        });
+}
+
+void LogicSystem::Reg(
+    http::verb method, const std::string& url, AsyncHttpHandler handler)
+{
+    HttpRoute route;
+    route.handler_ = std::move(handler);
+    route.limit_   = limiter_.RuleFor(url);
+    router_.Add(method, url, std::move(route));
 }
 
 void LogicSystem::RegGet(const std::string& url, HttpHandler handler)
 {
-    m_get_handlers.insert(make_pair(url, handler));
+    Reg(http::verb::get, url,
+        [this, handler](std::shared_ptr<HttpConnection> con, HttpDone done) {
+            Dispatch(handler, con, done);
+        });
 }
 
 void LogicSystem::RegPost(const std::string& url, HttpHandler handler)
 {
-    m_post_handlers.insert(make_pair(url, handler));
+    Reg(http::verb::post, url,
+        [this, handler](std::shared_ptr<HttpConnection> con, HttpDone done) {
+            Dispatch(handler, con, done);
+        });
+}
+
+void LogicSystem::RegGetAsync(const std::string& url, AsyncHttpHandler handler)
+{
+    Reg(http::verb::get, url, std::move(handler));
+}
+
+void LogicSystem::RegPostAsync(const std::string& url, AsyncHttpHandler handler)
+{
+    Reg(http::verb::post, url, std::move(handler));
 }
 
-LogicSystem::~LogicSystem() {}
+LogicSystem::~LogicSystem() { workers_->Stop(); }
+
+void LogicSystem::ServerBusy(
+    std::shared_ptr<HttpConnection> con, HttpDone done)
+{
+    con->response_.result(http::status::service_unavailable);
+    con->response_.set(http::field::content_type, "text/plain");
+    con->response_.body().append("server busy\r\n");
+    done();
+}
+
+void LogicSystem::TooManyRequests(
+    std::shared_ptr<HttpConnection> con, HttpDone done)
+{
+    con->response_.result(http::status::too_many_requests);
+    con->response_.set(http::field::content_type, "text/json");
+    con->response_.set(http::field::retry_after, "1");
+    WriteError(con->response_.body(), ErrorCodes::TooManyRequests);
+    done();
+}
+
+void LogicSystem::Dispatch(const HttpHandler& handler,
+    std::shared_ptr<HttpConnection> con, HttpDone done)
+{
+    // 处理函数表在构造后不再修改, 可以直接捕获引用
+    auto work = [&handler, con, done]() {
+        try
+        {
+            handler(con);
+        }
+        catch (std::exception& exp)
+        {
+            LOG_ERROR("Exception: {}", exp.what());
+            con->response_.result(http::status::internal_server_error);
+        }
+        done();
+    };
+    // 排队超时或队列已满时直接回 503, 避免请求堆积
+    auto busy = [con, done]() { ServerBusy(con, done); };
+    if (!workers_->Post(work, deadline_, busy))
+    {
+        LOG_WARN("handler queue full, size: {}", workers_->QueueSize());
+        busy();
+    }
+}
 
-bool LogicSystem::HandleGet(
-    const std::string& path, std::shared_ptr<HttpConnection> con)
+bool LogicSystem::CheckRateLimit(const HttpRoute& route,
+    std::shared_ptr<HttpConnection> con, HttpDone done)
 {
-    if (!m_get_handlers.count(path))
+    auto& rule = *route.limit_;
+
+    auto& address = con->remote_;
+    // 本地桶直接用地址的字节做 key, 不做字符串转换
+    std::string_view                ip;
+    net::ip::address_v4::bytes_type v4;
+    net::ip::address_v6::bytes_type v6;
+    if (address.is_v4())
+    {
+        v4 = address.to_v4().to_bytes();
+        ip = std::string_view((const char*)v4.data(), v4.size());
+    }
+    else
+    {
+        v6 = address.to_v6().to_bytes();
+        ip = std::string_view((const char*)v6.data(), v6.size());
+    }
+
+    std::string account;
+    if (!rule.account_field_.empty())
     {
+        account = RateLimiter::ReadAccount(
+            con->request_.body(), rule.account_field_);
+    }
+
+    if (!limiter_.Allow(rule, ip, account))
+    {
+        TooManyRequests(con, done);
         return false;
     }
+    if (!limiter_.Global())
+    {
+        return true;
+    }
 
-    m_get_handlers[path](con);
-    return true;
+    // 全局限流需要访问 redis, 放到业务线程中检查后再执行处理函数
+    auto work = [this, &route, con, done, ip = address.to_string(),
+                    account = std::move(account)]() {
+        if (!limiter_.AllowGlobal(*route.limit_, ip, account))
+        {
+            TooManyRequests(con, done);
+            return;
+        }
+        route.handler_(con, done);
+    };
+    auto busy = [con, done]() { ServerBusy(con, done); };
+    if (!workers_->Post(work, deadline_, busy))
+    {
+        busy();
+    }
+    return false;
 }
 
-bool LogicSystem::HandlePost(
-    const std::string& path, std::shared_ptr<HttpConnection> con)
+http::status LogicSystem::HandleRequest(std::shared_ptr<HttpConnection> con)
 {
-    if (!m_post_handlers.count(path))
+    const HttpRoute* route = nullptr;
+    switch (router_.Match(
+        con->request_.method(), con->path_, con->path_params_, route))
     {
-        return false;
+        case Router<HttpRoute>::Result::NotFound:
+            return http::status::not_found;
+        case Router<HttpRoute>::Result::MethodNotAllowed:
+            return http::status::method_not_allowed;
+        default: break;
     }
 
-    m_post_handlers[path](con);
-    return true;
+    con->in_flight_ = std::make_shared<InFlightGuard>(in_flight_);
+    HttpDone done   = [con]() { con->CompleteResponse(); };
+    if (route->limit_ && !CheckRateLimit(*route, con, done))
+    {
+        return http::status::ok;
+    }
+    route->handler_(con, done);
+    return http::status::ok;
 }
@@ -1,25 +1,68 @@
 #pragma once
 
+#include "RateLimiter.h"
+#include "Router.h"
 #include "Singleton.h"
+#include "WorkerPool.h"
 
+#include <boost/beast/http.hpp>
+
+#include <atomic>
 #include <functional>
-#include <unordered_map>
+#include <memory>
 
 class HttpConnection;
 typedef std::function<void(std::shared_ptr<HttpConnection>)> HttpHandler;
+// 异步处理函数: 填好 response_ 后调用 done 写回, done 可在任意线程调用
+typedef std::function<void()> HttpDone;
+typedef std::function<void(std::shared_ptr<HttpConnection>, HttpDone)>
+    AsyncHttpHandler;
+
+struct HttpRoute
+{
+    AsyncHttpHandler                     handler_;
+    std::shared_ptr<const RateLimitRule> limit_;
+};
+
 class LogicSystem : public Singleton<LogicSystem>
 {
     friend class Singleton<LogicSystem>;
 
   public:
     ~LogicSystem();
-    bool HandleGet(const std::string&, std::shared_ptr<HttpConnection>);
+    // 按方法与路径分发, 未命中时返回 not_found 或 method_not_allowed
+    http::status HandleRequest(std::shared_ptr<HttpConnection>);
+    // 路径支持 :name 参数段, 如 /user/:uid/avatar
     void RegGet(const std::string&, HttpHandler handler);
     void RegPost(const std::string&, HttpHandler handler);
-    bool HandlePost(const std::string&, std::shared_ptr<HttpConnection>);
+    // 异步处理函数直接在 io 线程中调用, 不能做阻塞操作
+    void RegGetAsync(const std::string&, AsyncHttpHandler handler);
+    void RegPostAsync(const std::string&, AsyncHttpHandler handler);
+
+    // 排空期间的响应不再保持长连接
+    void Drain() { draining_ = true; }
+    bool Draining() const { return draining_; }
+    // 已交给处理函数但响应尚未写完的请求数
+    int InFlight() const { return in_flight_; }
 
   private:
     LogicSystem();
-    std::unordered_map<std::string, HttpHandler> m_post_handlers;
-    std::unordered_map<std::string, HttpHandler> m_get_handlers;
+    // 处理函数可能阻塞在 MySQL/gRPC 上, 统一投递到业务线程池执行
+    void Dispatch(const HttpHandler& handler, std::shared_ptr<HttpConnection>,
+        HttpDone done);
+    void Reg(http::verb method, const std::string& url, AsyncHttpHandler);
+    // 限流检查在解析 JSON 与访问 DB 之前进行
+    // 返回 false 表示请求已被拒绝, 或已转交业务线程做全局检查
+    bool CheckRateLimit(const HttpRoute& route,
+        std::shared_ptr<HttpConnection> con, HttpDone done);
+
+    static void ServerBusy(std::shared_ptr<HttpConnection>, HttpDone done);
+    static void TooManyRequests(std::shared_ptr<HttpConnection>, HttpDone done);
+
+    std::unique_ptr<WorkerPool> workers_;
+    std::chrono::milliseconds   deadline_;
+    RateLimiter                 limiter_;
+    Router<HttpRoute>           router_;
+    std::atomic<bool>           draining_{false};
+    std::atomic<int>            in_flight_{0};
 };
@@ -0,0 +1,224 @@
+#include "RateLimiter.h"
+#include "ConfigMgr.h"
+#include "JsonFieldReader.h"
+#include "Logger.h"
+#include "RedisMgr.h"
+#include "const.h"
+
+#include <algorithm>
+#include <chrono>
+#include <sstream>
+
+namespace
+{
+const uint64_t kTokenBits = 24;
+const uint64_t kTokenMask = (1ULL << kTokenBits) - 1;
+const size_t   kProbes    = 4;
+
+uint64_t Hash(uint64_t seed, std::string_view data)
+{
+    uint64_t h = 1469598103934665603ULL ^ seed;
+    for (unsigned char c : data)
+    {
+        h ^= c;
+        h *= 1099511628211ULL;
+    }
+    // tag 为 0 表示空槽
+    return h == 0 ? 1 : h;
+}
+
+uint64_t NowMs()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+double ToDouble(const std::string& str, double def)
+{
+    return str.empty() ? def : std::stod(str);
+}
+
+int64_t ToInt(const std::string& str, int64_t def)
+{
+    return str.empty() ? def : std::stoll(str);
+}
+}  // namespace
+
+TokenBuckets::TokenBuckets(size_t slots)
+    : size_(std::max<size_t>(slots, kProbes)), slots_(new Slot[size_])
+{}
+
+bool TokenBuckets::Take(uint64_t key, double rate, double burst)
+{
+    uint64_t now = NowMs();
+    uint64_t cap = std::min<uint64_t>(burst * 1000, kTokenMask);
+
+    Slot*    slot        = nullptr;
+    Slot*    victim      = nullptr;
+    uint64_t victim_last = UINT64_MAX;
+    for (size_t i = 0; i < kProbes && slot == nullptr; ++i)
+    {
+        Slot&    s   = slots_[(key + i) % size_];
+        uint64_t tag = s.tag.load(std::memory_order_acquire);
+        if (tag == key)
+        {
+            slot = &s;
+        }
+        else if (tag == 0 && s.tag.compare_exchange_strong(tag, key))
+        {
+            // state 为 0 时按很久以前补充过处理, 下面会补满
+            slot = &s;
+        }
+        else
+        {
+            uint64_t last =
+                s.state.load(std::memory_order_relaxed) >> kTokenBits;
+            if (last < victim_last)
+            {
+                victim      = &s;
+                victim_last = last;
+            }
+        }
+    }
+    if (slot == nullptr)
+    {
+        // 挤占最久未使用的槽位, 新 key 从空桶开始按速率补充
+        // 否则不断更换 key 的请求每次都能拿到满桶
+        slot = victim;
+        slot->tag.store(key, std::memory_order_release);
+        slot->state.store(now << kTokenBits, std::memory_order_release);
+    }
+
+    uint64_t state = slot->state.load(std::memory_order_acquire);
+    for (;;)
+    {
+        uint64_t last    = state >> kTokenBits;
+        uint64_t tokens  = state & kTokenMask;
+        uint64_t elapsed = now > last ? now - last : 0;
+        // rate 个令牌每秒, 即每毫秒 rate 个千分之一令牌
+        tokens = std::min<uint64_t>(cap, tokens + elapsed * rate);
+        if (tokens < 1000)
+        {
+            return false;
+        }
+        uint64_t next = (std::max(now, last) << kTokenBits) | (tokens - 1000);
+        if (slot->state.compare_exchange_weak(state, next))
+        {
+            return true;
+        }
+    }
+}
+
+RateLimiter::RateLimiter()
+    : enabled_(ConfigMgr::Inst()["RateLimit"]["Enabled"] == "true"),
+      global_(ConfigMgr::Inst()["RateLimit"]["Global"] == "true"),
+      buckets_(ToInt(ConfigMgr::Inst()["RateLimit"]["Slots"], 65536))
+{
+    auto&             cfg = ConfigMgr::Inst();
+    std::stringstream ss(cfg["RateLimit"]["Routes"]);
+    std::string       name;
+    uint64_t          id = 0;
+    while (std::getline(ss, name, ','))
+    {
+        name.erase(0, name.find_first_not_of(' '));
+        name.erase(name.find_last_not_of(' ') + 1);
+        if (name.empty())
+        {
+            continue;
+        }
+
+        auto section = cfg["RateLimit_" + name];
+        auto rule    = std::make_shared<RateLimitRule>();
+
+        rule->id_            = ++id;
+        rule->ip_rate_       = ToDouble(section["IpRate"], 0);
+        rule->ip_burst_      = ToDouble(section["IpBurst"], rule->ip_rate_);
+        rule->account_rate_  = ToDouble(section["AccountRate"], 0);
+        rule->account_burst_ = ToDouble(section["AccountBurst"], 1);
+        rule->account_field_ = section["AccountField"];
+        rule->window_ms_     = ToInt(section["WindowMs"], 60000);
+        rule->ip_limit_      = ToInt(section["IpLimit"], 0);
+        rule->account_limit_ = ToInt(section["AccountLimit"], 0);
+        rules_["/" + name]   = rule;
+    }
+    LOG_INFO("rate limit enabled: {}, global: {}, routes: {}", enabled_,
+             global_, rules_.size());
+}
+
+std::shared_ptr<const RateLimitRule> RateLimiter::RuleFor(
+    const std::string& url)
+{
+    auto iter = rules_.find(url);
+    if (!enabled_ || iter == rules_.end())
+    {
+        return nullptr;
+    }
+    return iter->second;
+}
+
+bool RateLimiter::Allow(
+    const RateLimitRule& rule, std::string_view ip, std::string_view account)
+{
+    // 不同路由、不同维度使用不同的种子, 共享同一张槽位表
+    if (rule.ip_rate_ > 0 &&
+        !buckets_.Take(
+            Hash(rule.id_ << 1, ip), rule.ip_rate_, rule.ip_burst_))
+    {
+        return false;
+    }
+    if (rule.account_rate_ > 0 && !account.empty() &&
+        !buckets_.Take(Hash(rule.id_ << 1 | 1, account),
+            rule.account_rate_, rule.account_burst_))
+    {
+        return false;
+    }
+    return true;
+}
+
+bool RateLimiter::AllowGlobal(const RateLimitRule& rule, const std::string& ip,
+    const std::string& account)
+{
+    auto route = std::to_string(rule.id_) + ":";
+    if (rule.ip_limit_ > 0 &&
+        RedisMgr::GetInstance()->SlidingWindow(IPCOUNTPREFIX + route + ip,
+            rule.window_ms_, rule.ip_limit_) == 0)
+    {
+        return false;
+    }
+    // account 已由 ReadAccount 规范化
+    if (rule.account_limit_ > 0 && !account.empty() &&
+        RedisMgr::GetInstance()->SlidingWindow(
+            ACCOUNTCOUNTPREFIX + route + account, rule.window_ms_,
+            rule.account_limit_) == 0)
+    {
+        return false;
+    }
+    return true;
+}
+
+std::string RateLimiter::ReadAccount(
+    std::string_view body, std::string_view field)
+{
+    std::string account;
+    if (!JsonFieldReader(body).Bind(field, account).Parse())
+    {
+        return {};
+    }
+
+    auto begin = account.find_first_not_of(" \t\r\n");
+    if (begin == std::string::npos)
+    {
+        return {};
+    }
+    auto end = account.find_last_not_of(" \t\r\n");
+    account  = account.substr(begin, end - begin + 1);
+    for (auto& c : account)
+    {
+        if (c >= 'A' && c <= 'Z')
+        {
+            c = c - 'A' + 'a';
+        }
+    }
+    return account;
+}
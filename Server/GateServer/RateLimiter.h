@@ -0,0 +1,80 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// 单个路由的限流规则, 速率为每秒补充的令牌数, 为 0 表示不限制该维度
+struct RateLimitRule
+{
+    uint64_t    id_            = 0;
+    double      ip_rate_       = 0;
+    double      ip_burst_      = 0;
+    double      account_rate_  = 0;
+    double      account_burst_ = 0;
+    std::string account_field_;
+    // redis 全局滑动窗口, 窗口内的请求数上限
+    int64_t window_ms_     = 0;
+    int64_t ip_limit_      = 0;
+    int64_t account_limit_ = 0;
+};
+
+// 无锁令牌桶表
+// key 哈希到固定大小的槽位表, 槽位状态打包在一个 64 位整数里用 CAS 更新
+// 表满时覆盖探测范围内最久未补充的槽位, 新 key 从空桶开始
+// 轮换 key 挤占槽位拿不到额外令牌
+class TokenBuckets
+{
+  public:
+    explicit TokenBuckets(size_t slots);
+
+    // 取走一个令牌, 桶空时返回 false
+    bool Take(uint64_t key, double rate, double burst);
+
+  private:
+    struct Slot
+    {
+        std::atomic<uint64_t> tag{0};
+        // 高 40 位为上次补充的毫秒时间, 低 24 位为千分之一令牌数
+        std::atomic<uint64_t> state{0};
+    };
+
+    size_t                  size_;
+    std::unique_ptr<Slot[]> slots_;
+};
+
+// GateServer 的限流入口
+// 本地令牌桶只看 IP 与请求体中的账号字段, 不访问 DB
+// [RateLimit] Global = true 时额外走 redis 滑动窗口, 用于多实例部署
+class RateLimiter
+{
+  public:
+    RateLimiter();
+
+    // 没有配置规则的路由返回空
+    std::shared_ptr<const RateLimitRule> RuleFor(const std::string& url);
+
+    bool Global() const { return global_; }
+
+    // 本地检查, 可在 io 线程中调用
+    bool Allow(const RateLimitRule& rule, std::string_view ip,
+        std::string_view account);
+    // redis 检查, 会阻塞, 需在业务线程中调用; redis 不可用时放行
+    bool AllowGlobal(const RateLimitRule& rule, const std::string& ip,
+        const std::string& account);
+
+    // 从 JSON 请求体中取出账号字段, 解码转义后去掉首尾空白并转为小写
+    // 同一账号的不同写法落到同一个桶; 找不到或请求体不合法时返回空
+    static std::string ReadAccount(
+        std::string_view body, std::string_view field);
+
+  private:
+    bool         enabled_;
+    bool         global_;
+    TokenBuckets buckets_;
+
+    std::unordered_map<std::string, std::shared_ptr<RateLimitRule>> rules_;
+};
@@ -0,0 +1,83 @@
+#include "Router.h"
+
+namespace
+{
+int FromHex(char x)
+{
+    if (x >= 'A' && x <= 'F')
+        return x - 'A' + 10;
+    if (x >= 'a' && x <= 'f')
+        return x - 'a' + 10;
+    if (x >= '0' && x <= '9')
+        return x - '0';
+    return -1;
+}
+
+bool NeedDecode(std::string_view str)
+{
+    return str.find_first_of("%+") != std::string_view::npos;
+}
+}  // namespace
+
+std::string QueryParams::Decode(std::string_view str)
+{
+    std::string result;
+    result.reserve(str.size());
+    for (size_t i = 0; i < str.size(); ++i)
+    {
+        if (str[i] == '+')
+        {
+            result += ' ';
+            continue;
+        }
+        if (str[i] == '%' && i + 2 < str.size())
+        {
+            int high = FromHex(str[i + 1]);
+            int low  = FromHex(str[i + 2]);
+            if (high >= 0 && low >= 0)
+            {
+                result += static_cast<char>(high * 16 + low);
+                i += 2;
+                continue;
+            }
+        }
+        // 非法的转义按原样保留
+        result += str[i];
+    }
+    return result;
+}
+
+void QueryParams::Parse(std::string_view query)
+{
+    pairs_.clear();
+    while (!query.empty())
+    {
+        size_t           amp  = query.find('&');
+        std::string_view pair = query.substr(0, amp);
+        query.remove_prefix(
+            amp == std::string_view::npos ? query.size() : amp + 1);
+
+        size_t eq = pair.find('=');
+        if (pair.empty() || eq == std::string_view::npos)
+        {
+            continue;
+        }
+        pairs_.emplace_back(pair.substr(0, eq), pair.substr(eq + 1));
+    }
+}
+
+bool QueryParams::Get(std::string_view key, std::string& value) const
+{
+    for (auto& pair : pairs_)
+    {
+        bool match = NeedDecode(pair.first) ? Decode(pair.first) == key
+                                            : pair.first == key;
+        if (match)
+        {
+            value = NeedDecode(pair.second) ? Decode(pair.second)
+                                            : std::string(pair.second);
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,197 @@
+#pragma once
+
+#include <boost/beast/http.hpp>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace http = boost::beast::http;
+
+// 查询串参数, 只保存指向请求 target 的 string_view, 取值时才解码
+class QueryParams
+{
+  public:
+    typedef std::pair<std::string_view, std::string_view> Pair;
+
+    void Parse(std::string_view query);
+    void Clear() { pairs_.clear(); }
+
+    size_t Size() const { return pairs_.size(); }
+    bool   Get(std::string_view key, std::string& value) const;
+
+    // 按出现顺序遍历, 键值均已解码
+    template <typename F>
+    void ForEach(F&& f) const
+    {
+        for (auto& pair : pairs_)
+        {
+            f(Decode(pair.first), Decode(pair.second));
+        }
+    }
+
+    static std::string Decode(std::string_view str);
+
+  private:
+    // vector 随连接复用, 预热后解析不再分配内存
+    std::vector<Pair> pairs_;
+};
+
+// 路径参数, 名字指向路由树, 值指向请求 target
+typedef std::vector<std::pair<std::string_view, std::string_view>> PathParams;
+
+// 按路径段组织的前缀树路由, 支持 :name 形式的路径参数
+// 匹配只做段比较, 复杂度与路径长度成正比; 静态段优先于参数段
+template <typename Handler>
+class Router
+{
+  public:
+    typedef PathParams Params;
+
+    enum class Result
+    {
+        Found,
+        NotFound,
+        MethodNotAllowed,
+    };
+
+    void Add(http::verb method, std::string_view pattern, Handler handler)
+    {
+        Node* node = &root_;
+        for (std::string_view seg : Split(pattern))
+        {
+            if (!seg.empty() && seg[0] == ':')
+            {
+                if (!node->param)
+                {
+                    node->param.reset(new Node);
+                    node->param->segment = std::string(seg.substr(1));
+                }
+                node = node->param.get();
+                continue;
+            }
+            Node* child = nullptr;
+            for (auto& c : node->children)
+            {
+                if (c->segment == seg)
+                {
+                    child = c.get();
+                    break;
+                }
+            }
+            if (child == nullptr)
+            {
+                node->children.emplace_back(new Node);
+                child          = node->children.back().get();
+                child->segment = std::string(seg);
+            }
+            node = child;
+        }
+        for (auto& h : node->handlers)
+        {
+            if (h.first == method)
+            {
+                h.second = std::move(handler);
+                return;
+            }
+        }
+        node->handlers.emplace_back(method, std::move(handler));
+    }
+
+    // 调用方需保证 path 在使用 params 期间有效
+    Result Match(http::verb method, std::string_view path, Params& params,
+        const Handler*& handler) const
+    {
+        params.clear();
+        bool matched = false;
+        handler      = Find(&root_, method, path, params, matched);
+        if (handler != nullptr)
+        {
+            return Result::Found;
+        }
+        // 只有所有命中路径的节点都不支持该方法时才返回 405
+        return matched ? Result::MethodNotAllowed : Result::NotFound;
+    }
+
+  private:
+    struct Node
+    {
+        std::string                                 segment;
+        std::vector<std::unique_ptr<Node>>          children;
+        std::unique_ptr<Node>                       param;
+        std::vector<std::pair<http::verb, Handler>> handlers;
+    };
+
+    static std::vector<std::string_view> Split(std::string_view path)
+    {
+        std::vector<std::string_view> segs;
+        while (!path.empty())
+        {
+            if (path[0] == '/')
+            {
+                path.remove_prefix(1);
+                continue;
+            }
+            size_t pos = path.find('/');
+            segs.push_back(path.substr(0, pos));
+            path.remove_prefix(pos == std::string_view::npos ? path.size()
+                                                             : pos);
+        }
+        return segs;
+    }
+
+    // 返回支持 method 的处理函数, 路径命中但方法不符时置 matched 并继续回溯
+    static const Handler* Find(const Node* node, http::verb method,
+        std::string_view path, Params& params, bool& matched)
+    {
+        while (!path.empty() && path[0] == '/')
+        {
+            path.remove_prefix(1);
+        }
+        if (path.empty())
+        {
+            for (auto& h : node->handlers)
+            {
+                if (h.first == method)
+                {
+                    return &h.second;
+                }
+            }
+            matched = matched || !node->handlers.empty();
+            return nullptr;
+        }
+        size_t           pos  = path.find('/');
+        std::string_view seg  = path.substr(0, pos);
+        std::string_view rest = path.substr(seg.size());
+        for (auto& c : node->children)
+        {
+            if (c->segment == seg)
+            {
+                const Handler* found =
+                    Find(c.get(), method, rest, params, matched);
+                if (found != nullptr)
+                {
+                    return found;
+                }
+                break;
+            }
+        }
+        // 静态段匹配失败时回退到参数段
+        if (node->param)
+        {
+            params.emplace_back(node->param->segment, seg);
+            const Handler* found =
+                Find(node->param.get(), method, rest, params, matched);
+            if (found != nullptr)
+            {
+                return found;
+            }
+            params.pop_back();
+        }
+        return nullptr;
+    }
+
+    Node root_;
+};
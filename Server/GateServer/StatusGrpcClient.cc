@@ -22,6 +22,39 @@ GetChatServerRsp StatusGrpcClient::GetChatServer(int uid)
     }
 }
 
+void StatusGrpcClient::GetChatServerAsync(int uid, ChatServerCallback cb)
+{
+    // 上下文与请求/应答需要存活到回调结束
+    struct Call
+    {
+        ClientContext    context;
+        GetChatServerReq request;
+        GetChatServerRsp reply;
+    };
+    auto call = std::make_shared<Call>();
+    call->request.set_uid(uid);
+    call->context.set_deadline(
+        std::chrono::system_clock::now() + std::chrono::seconds(5));
+
+    auto stub = pool_->getConnection();
+    if (stub == nullptr)
+    {
+        call->reply.set_error(ErrorCodes::RPCFailed);
+        cb(call->reply);
+        return;
+    }
+    stub->async()->GetChatServer(&call->context, &call->request, &call->reply,
+        [call, cb](Status status) {
+            if (!status.ok())
+            {
+                call->reply.set_error(ErrorCodes::RPCFailed);
+            }
+            cb(call->reply);
+        });
+    // Stub 是线程安全的, 发起调用后即可归还
+    pool_->returnConnection(std::move(stub));
+}
+
 StatusGrpcClient::StatusGrpcClient()
 {
     auto&       gCfgMgr = ConfigMgr::Inst();
@@ -5,6 +5,7 @@
 #include "message.pb.h"
 
 #include <condition_variable>
+#include <functional>
 #include <grpcpp/grpcpp.h>
 #include <mutex>
 #include <queue>
@@ -97,8 +98,12 @@ class StatusGrpcClient : public Singleton<StatusGrpcClient>
     friend class Singleton<StatusGrpcClient>;
 
   public:
+    typedef std::function<void(const GetChatServerRsp&)> ChatServerCallback;
+
     ~StatusGrpcClient() {}
     GetChatServerRsp GetChatServer(int uid);
+    // 回调在 gRPC 内部线程中执行, 调用方不会被阻塞
+    void GetChatServerAsync(int uid, ChatServerCallback cb);
 
   private:
     StatusGrpcClient();
@@ -5,6 +5,7 @@
 #include "message.grpc.pb.h"
 
 #include <condition_variable>
+#include <functional>
 #include <grpcpp/grpcpp.h>
 #include <memory>
 #include <queue>
@@ -96,6 +97,8 @@ class VerifyGrpcClient : public Singleton<VerifyGrpcClient>
     friend class Singleton<VerifyGrpcClient>;
 
   public:
+    typedef std::function<void(const GetVarifyRsp&)> VarifyCallback;
+
     ~VerifyGrpcClient() {}
     GetVarifyRsp GetVarifyCode(std::string email)
     {
@@ -119,6 +122,9 @@ class VerifyGrpcClient : public Singleton<VerifyGrpcClient>
         }
     }
 
+    // 回调在 gRPC 内部线程中执行, 调用方不会被阻塞
+    void GetVarifyCodeAsync(const std::string& email, VarifyCallback cb);
+
   private:
     VerifyGrpcClient();
 
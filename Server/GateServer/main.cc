@@ -16,19 +16,28 @@ int main()
         std::string    gate_port_str = gCfgMgr["GateServer"]["Port"];
         unsigned short gate_port     = stoi(gate_port_str);
 
+        // 排空时等待处理中请求的最长时间(秒)
+        std::string drain_str = gCfgMgr["GateServer"]["DrainTimeout"];
+        auto        drain_timeout =
+            std::chrono::seconds(drain_str.empty() ? 10 : stoi(drain_str));
+
         net::io_context         ioc{1};
         boost::asio::signal_set signals(ioc, SIGINT, SIGTERM);
+        auto server = std::make_shared<GateServer>(ioc, gate_port);
 
-        signals.async_wait(
-            [&ioc](const boost::system::error_code& error, int signal_number) {
-                if (error)
-                {
-                    return;
-                }
-                ioc.stop();
-            });
+        // 第一次收到信号时排空, 排空期间再次收到信号则立即退出
+        signals.async_wait([&](const boost::system::error_code& error,
+                               int signal_number) {
+            if (error)
+            {
+                return;
+            }
+            server->Drain(drain_timeout, [&ioc]() { ioc.stop(); });
+            signals.async_wait(
+                [&ioc](const boost::system::error_code&, int) { ioc.stop(); });
+        });
 
-        std::make_shared<GateServer>(ioc, gate_port)->Start();
+        server->Start();
         LOG_INFO("GateServer is running on port {}", gate_port);
         ioc.run();
     }
@@ -2,6 +2,7 @@
 #include "ConfigMgr.h"
 #include "Logger.h"
 #include "RedisMgr.h"
+#include "TokenSigner.h"
 #include "const.h"
 
 #include <boost/uuid/uuid.hpp>
@@ -28,6 +29,18 @@ Status StatusServiceImpl::GetChatServer(ServerContext* context,
     reply->set_host(server.host_);
     reply->set_port(server.port_);
     reply->set_error(ErrorCodes::Success);
+    // 签名 token 由 ChatServer 本地校验, 不需要写 redis
+    if (TokenSigner::GetInstance()->Enabled())
+    {
+        auto token =
+            TokenSigner::GetInstance()->Mint(request->uid(), server.name_);
+        if (token.empty())
+        {
+            reply->set_error(ErrorCodes::RPCFailed);
+        }
+        reply->set_token(token);
+        return Status::OK;
+    }
     reply->set_token(generate_unique_string());
     insertToken(request->uid(), reply->token());
     return Status::OK;
@@ -61,26 +74,77 @@ StatusServiceImpl::StatusServiceImpl()
         server.name_           = cfg[word]["Name"];
         servers_[server.name_] = server;
     }
+
+    auto host = cfg["Redis"]["Host"];
+    auto port = cfg["Redis"]["Port"];
+    auto pwd  = cfg["Redis"]["Passwd"];
+    subscriber_.reset(new RedisSubscriber(host, stoi(port), pwd));
+    subscriber_->Subscribe(LOGIN_COUNT_CHANNEL,
+        [this](const std::string&, const std::string& message) {
+            onCountChanged(message);
+        });
+    // 断线重连很快时 getCount 可能观察不到断开, 在重连时清掉旧数据
+    subscriber_->OnConnected([this]() {
+        std::lock_guard<std::mutex> guard(mutex_);
+        live_counts_.clear();
+    });
+    subscriber_->Start();
 }
 
-ChatServer StatusServiceImpl::getChatServer()
+StatusServiceImpl::~StatusServiceImpl() { subscriber_->Stop(); }
+
+void StatusServiceImpl::onCountChanged(const std::string& message)
 {
-    LOG_INFO("Redis get chat server begin");
+    auto pos = message.rfind(':');
+    if (pos == std::string::npos)
+    {
+        return;
+    }
+    auto name  = message.substr(0, pos);
+    int  count = std::atoi(message.c_str() + pos + 1);
+
     std::lock_guard<std::mutex> guard(mutex_);
-    auto                        minServer = servers_.begin()->second;
+    // 服务器下线
+    if (count < 0)
+    {
+        live_counts_.erase(name);
+        return;
+    }
+    live_counts_[name] = count;
+}
 
-    auto count_str =
-        RedisMgr::GetInstance()->HGet(LOGIN_COUNT, minServer.name_);
-    if (count_str.empty())
+int StatusServiceImpl::getCount(const std::string& name)
+{
+    if (subscriber_->IsConnected())
     {
-        // 不存在则默认设置为最大
-        minServer.con_count = INT_MAX;
+        auto it = live_counts_.find(name);
+        if (it != live_counts_.end())
+        {
+            return it->second;
+        }
     }
     else
     {
-        minServer.con_count = std::stoi(count_str);
+        // 订阅断开期间可能漏掉消息, 已缓存的数据不再可信
+        live_counts_.clear();
     }
 
+    auto count_str = RedisMgr::GetInstance()->HGet(LOGIN_COUNT, name);
+    if (count_str.empty())
+    {
+        // 不存在则默认设置为最大
+        return INT_MAX;
+    }
+    return std::stoi(count_str);
+}
+
+ChatServer StatusServiceImpl::getChatServer()
+{
+    LOG_INFO("Redis get chat server begin");
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto                        minServer = servers_.begin()->second;
+    minServer.con_count                   = getCount(minServer.name_);
+
     // 使用范围基于for循环
     for (auto& server : servers_)
     {
@@ -90,22 +154,20 @@ ChatServer StatusServiceImpl::getChatServer()
             continue;
         }
 
-        auto count_str =
-            RedisMgr::GetInstance()->HGet(LOGIN_COUNT, server.second.name_);
-        if (count_str.empty())
-        {
-            server.second.con_count = INT_MAX;
-        }
-        else
-        {
-            server.second.con_count = std::stoi(count_str);
-        }
+        server.second.con_count = getCount(server.second.name_);
 
         if (server.second.con_count < minServer.con_count)
         {
             minServer = server.second;
         }
     }
+
+    // 预先计入即将到来的登录, 避免下次发布前的突发请求都分到同一台
+    auto it = live_counts_.find(minServer.name_);
+    if (it != live_counts_.end())
+    {
+        it->second++;
+    }
     LOG_INFO("Redis get chat server finish");
     return minServer;
 }
@@ -1,9 +1,12 @@
 #pragma once
 
+#include "RedisSubscriber.h"
 #include "message.grpc.pb.h"
 
 #include <grpcpp/grpcpp.h>
+#include <memory>
 #include <mutex>
+#include <unordered_map>
 
 using grpc::Server;
 using grpc::ServerBuilder;
@@ -47,12 +50,18 @@ class StatusServiceImpl final : public StatusService::Service
 {
   public:
     StatusServiceImpl();
+    ~StatusServiceImpl();
     Status GetChatServer(ServerContext* context,
         const GetChatServerReq* request, GetChatServerRsp* reply) override;
 
   private:
     void       insertToken(int uid, std::string token);
     ChatServer getChatServer();
+    int        getCount(const std::string& name);
+    void       onCountChanged(const std::string& message);
     std::unordered_map<std::string, ChatServer> servers_;
     std::mutex                                  mutex_;
+    // 订阅chatserver发布的登录数, 没有收到时退回到HGET
+    std::unique_ptr<RedisSubscriber>     subscriber_;
+    std::unordered_map<std::string, int> live_counts_;
 };
@@ -21,6 +21,31 @@ CREATE TABLE `friend`  (
 -- Records of friend
 -- ----------------------------
 
+-- ----------------------------
+-- Table structure for friend_change
+-- ----------------------------
+DROP TABLE IF EXISTS `friend_change`;
+CREATE TABLE `friend_change`  (
+  `id` bigint UNSIGNED NOT NULL AUTO_INCREMENT,
+  `uid` int NOT NULL,
+  `version` bigint UNSIGNED NOT NULL,
+  `peer_uid` int NOT NULL,
+  `op` smallint NOT NULL,
+  `status` smallint NOT NULL DEFAULT 0,
+  PRIMARY KEY (`id`) USING BTREE,
+  UNIQUE INDEX `uid_version`(`uid` ASC, `version` ASC) USING BTREE
+) ENGINE = InnoDB CHARACTER SET = utf8mb4 COLLATE = utf8mb4_unicode_ci ROW_FORMAT = Dynamic;
+
+-- ----------------------------
+-- Table structure for friend_version
+-- ----------------------------
+DROP TABLE IF EXISTS `friend_version`;
+CREATE TABLE `friend_version`  (
+  `uid` int NOT NULL,
+  `version` bigint UNSIGNED NOT NULL DEFAULT 0,
+  PRIMARY KEY (`uid`) USING BTREE
+) ENGINE = InnoDB CHARACTER SET = utf8mb4 COLLATE = utf8mb4_unicode_ci ROW_FORMAT = Dynamic;
+
 -- ----------------------------
 -- Table structure for friend_apply
 -- ----------------------------
@@ -52,16 +77,17 @@ CREATE TABLE `user`  (
   `desc` varchar(255) CHARACTER SET utf8mb4 COLLATE utf8mb4_unicode_ci NOT NULL DEFAULT '',
   `sex` int NOT NULL DEFAULT 0,
   `icon` varchar(255) CHARACTER SET utf8mb4 COLLATE utf8mb4_unicode_ci NOT NULL DEFAULT '',
+  `update_time` timestamp(3) NOT NULL DEFAULT CURRENT_TIMESTAMP(3) ON UPDATE CURRENT_TIMESTAMP(3),
   PRIMARY KEY (`id`) USING BTREE,
   UNIQUE INDEX `uid`(`uid` ASC) USING BTREE,
   UNIQUE INDEX `email`(`email` ASC) USING BTREE,
-  INDEX `name`(`name` ASC) USING BTREE
+  UNIQUE INDEX `name`(`name` ASC) USING BTREE
 ) ENGINE = InnoDB AUTO_INCREMENT = 61 CHARACTER SET = utf8mb4 COLLATE = utf8mb4_unicode_ci ROW_FORMAT = DYNAMIC;
 
 -- ----------------------------
 -- Records of user
 -- ----------------------------
-INSERT INTO `user` VALUES (1, 1000, 'rain', '20520@126.com', '745230', 'klaus', '', 0, ':/res/head_1.jpg');
+INSERT INTO `user` (`id`, `uid`, `name`, `email`, `pwd`, `nick`, `desc`, `sex`, `icon`) VALUES (1, 1000, 'rain', '20520@126.com', '745230', 'klaus', '', 0, ':/res/head_1.jpg');
 -- Table structure for user_id
 -- ----------------------------
 DROP TABLE IF EXISTS `user_id`;